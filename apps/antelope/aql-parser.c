@@ -502,14 +502,31 @@ PARSER(select)
     }
 
     AQL_SET_CONDITION(adt, &p);
-  } else {
-    REWIND;
-    RETURN(OK);
+    NEXT;
   }
 
-  CONSUME(END);
+#if DB_FEATURE_GROUP
+  if(TOKEN == GROUP) {
+    CONSUME(BY);
+    CONSUME(IDENTIFIER);
 
-  return OK;
+    if(DB_ERROR(AQL_SET_GROUP(adt, VALUE))) {
+      RETURN(SYNTAX_ERROR);
+    }
+    PRINTF("Group by attribute %s\n", VALUE);
+    NEXT;
+  }
+#endif /* DB_FEATURE_GROUP */
+
+  if(TOKEN != END) {
+    if(adt->lvm_instance != NULL ||
+       (AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP)) {
+      RETURN(SYNTAX_ERROR);
+    }
+    REWIND;
+  }
+
+  RETURN(OK);
 }
 
 PARSER(insert)
@@ -645,6 +662,9 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+  case BTREE:
+    type = INDEX_BTREE;
+    break;
   default:
     return NONE;
   };
@@ -54,6 +54,11 @@
 #define DB_FEATURE_REMOVE		1
 #endif /* DB_FEATURE_REMOVE */
 
+/* Support grouping of aggregated results (GROUP BY). */
+#ifndef DB_FEATURE_GROUP
+#define DB_FEATURE_GROUP		1
+#endif /* DB_FEATURE_GROUP */
+
 /* Support floating-point values in attributes. */
 #ifndef DB_FEATURE_FLOATS
 #define DB_FEATURE_FLOATS		0
@@ -110,6 +115,27 @@
 #define DB_VM_BYTECODE_SIZE		128
 #endif /* DB_VM_BYTECODE_SIZE */
 
+/* The number of tuples that a full relation scan reads from storage and
+   evaluates at a time. A batch takes up to DB_MAX_CHAR_SIZE_PER_ROW
+   bytes of RAM per tuple. Set to 1 to read one tuple at a time. */
+#ifndef DB_SCAN_BATCH_SIZE
+#define DB_SCAN_BATCH_SIZE		8
+#endif /* DB_SCAN_BATCH_SIZE */
+
+/* The number of groups that a GROUP BY query aggregates in RAM at a
+   time. The tuples of further groups are moved to a temporary relation
+   in storage and aggregated in later passes. */
+#ifndef DB_GROUP_LIMIT
+#define DB_GROUP_LIMIT			8
+#endif /* DB_GROUP_LIMIT */
+
+/* The number of tuples from the left relation that a join keeps in RAM
+   when the attribute to join on is not indexed in the right relation.
+   The right relation is scanned once for each such block of tuples. */
+#ifndef DB_JOIN_BLOCK_SIZE
+#define DB_JOIN_BLOCK_SIZE		4
+#endif /* DB_JOIN_BLOCK_SIZE */
+
 /*----------------------------------------------------------------------------*/
 
 /* Language options. */
@@ -178,6 +204,12 @@
 #define REMOVE_RELATION			"db-remove"
 #endif /* REMOVE_RELATION */
 
+/* The name of the relation that holds the tuples of the groups that
+   do not fit in RAM during a GROUP BY query. */
+#ifndef GROUP_RELATION
+#define GROUP_RELATION			"db-group"
+#endif /* GROUP_RELATION */
+
 /*----------------------------------------------------------------------------*/
 
 /* Index options. */
@@ -206,6 +238,26 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BTREE_INDEX_LIMIT
+#define DB_BTREE_INDEX_LIMIT		1
+#endif /* DB_BTREE_INDEX_LIMIT */
+
+/* The maximum number of keys in a B+-tree node. */
+#ifndef DB_BTREE_NODE_KEYS
+#define DB_BTREE_NODE_KEYS		14
+#endif /* DB_BTREE_NODE_KEYS */
+
+/* The number of B+-tree nodes cached in RAM. */
+#ifndef DB_BTREE_CACHE_LIMIT
+#define DB_BTREE_CACHE_LIMIT		4
+#endif /* DB_BTREE_CACHE_LIMIT */
+
+/* The number of nodes to reserve space for in a new B+-tree file. */
+#ifndef DB_BTREE_RESERVE_NODES
+#define DB_BTREE_RESERVE_NODES		64
+#endif /* DB_BTREE_RESERVE_NODES */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
@@ -0,0 +1,676 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *     A B+-tree index stored in a file.
+ *
+ *     Internal nodes hold separator keys and the node numbers of their
+ *     children, and leaf nodes hold keys and tuple IDs in ascending key
+ *     order. The leaves are linked from left to right, so a range query
+ *     descends once to the first key in the range and then scans the
+ *     leaves. Nodes are cached in RAM, and leaves are evicted from the
+ *     cache before internal nodes so that the upper levels of the tree
+ *     normally stay cached.
+ *
+ *     Deletions remove the keys from the leaves but do not merge nodes,
+ *     as the index is mainly intended for append-mostly sensor data.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/uip-debug.h"
+
+#define MAX_HEIGHT		8
+#define NO_NODE			0
+#define INVALID_NODE		0xffff
+
+typedef long btree_key_t;
+typedef uint16_t btree_node_id_t;
+
+/* The header at the beginning of the index file. */
+struct btree_header {
+  btree_node_id_t root;
+  btree_node_id_t node_count;
+  uint8_t height;
+};
+
+/* A leaf node stores one tuple ID for each key, and an internal node
+   stores one child more than it has keys. */
+struct btree_node {
+  uint8_t leaf;
+  uint8_t count;
+  /* The next leaf to the right, or NO_NODE. The first leaf is node 0,
+     which is never the next leaf of any other leaf. */
+  btree_node_id_t next;
+  btree_key_t keys[DB_BTREE_NODE_KEYS];
+  uint32_t ptrs[DB_BTREE_NODE_KEYS + 1];
+};
+
+struct btree {
+  db_storage_id_t storage;
+  struct btree_header header;
+};
+typedef struct btree btree_t;
+
+struct node_cache {
+  btree_t *tree;
+  btree_node_id_t id;
+  uint16_t last_use;
+  struct btree_node node;
+};
+
+static struct node_cache node_cache[DB_BTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+MEMB(btrees, btree_t, DB_BTREE_INDEX_LIMIT);
+
+static db_result_t open_tree(index_t *);
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_btree = {
+  INDEX_BTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+static unsigned long
+node_offset(btree_node_id_t id)
+{
+  return sizeof(struct btree_header) +
+         (unsigned long)id * sizeof(struct btree_node);
+}
+
+static struct node_cache *
+cache_find(btree_t *tree, btree_node_id_t id)
+{
+  int i;
+
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree && node_cache[i].id == id) {
+      return &node_cache[i];
+    }
+  }
+  return NULL;
+}
+
+static struct node_cache *
+cache_get_free(void)
+{
+  int i;
+  struct node_cache *victim;
+
+  /* Prefer a free entry, then the least recently used leaf, and only
+     then the least recently used internal node. */
+  victim = NULL;
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == NULL) {
+      return &node_cache[i];
+    }
+    if(victim == NULL ||
+       (node_cache[i].node.leaf && !victim->node.leaf) ||
+       (node_cache[i].node.leaf == victim->node.leaf &&
+        (uint16_t)(cache_clock - node_cache[i].last_use) >
+        (uint16_t)(cache_clock - victim->last_use))) {
+      victim = &node_cache[i];
+    }
+  }
+  return victim;
+}
+
+static void
+cache_invalidate(btree_t *tree)
+{
+  int i;
+
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree) {
+      node_cache[i].tree = NULL;
+    }
+  }
+}
+
+static void
+cache_put(btree_t *tree, btree_node_id_t id, struct btree_node *node)
+{
+  struct node_cache *cache;
+
+  cache = cache_find(tree, id);
+  if(cache == NULL) {
+    cache = cache_get_free();
+    cache->tree = tree;
+    cache->id = id;
+  }
+  cache->last_use = ++cache_clock;
+  memcpy(&cache->node, node, sizeof(*node));
+}
+
+static int
+node_read(btree_t *tree, btree_node_id_t id, struct btree_node *node)
+{
+  struct node_cache *cache;
+
+  cache = cache_find(tree, id);
+  if(cache != NULL) {
+    cache->last_use = ++cache_clock;
+    memcpy(node, &cache->node, sizeof(*node));
+    return 1;
+  }
+
+  if(DB_ERROR(storage_read(tree->storage, node, node_offset(id),
+                           sizeof(*node)))) {
+    PRINTF("DB: Failed to read B+-tree node %u\n", (unsigned)id);
+    return 0;
+  }
+  cache_put(tree, id, node);
+  return 1;
+}
+
+static int
+node_write(btree_t *tree, btree_node_id_t id, struct btree_node *node)
+{
+  if(DB_ERROR(storage_write(tree->storage, node, node_offset(id),
+                            sizeof(*node)))) {
+    PRINTF("DB: Failed to write B+-tree node %u\n", (unsigned)id);
+    return 0;
+  }
+  cache_put(tree, id, node);
+  return 1;
+}
+
+static int
+header_write(btree_t *tree)
+{
+  return !DB_ERROR(storage_write(tree->storage, &tree->header, 0,
+                                 sizeof(tree->header)));
+}
+
+/* Return the position of the first key that is greater than the key,
+   or greater than or equal to it if "inclusive" is set. */
+static int
+search_node(struct btree_node *node, btree_key_t key, int inclusive)
+{
+  int min, max, center;
+
+  min = 0;
+  max = node->count;
+  while(min < max) {
+    center = min + (max - min) / 2;
+    if(node->keys[center] < key ||
+       (!inclusive && node->keys[center] == key)) {
+      min = center + 1;
+    } else {
+      max = center;
+    }
+  }
+  return min;
+}
+
+/* Find the leftmost leaf that may contain the key. */
+static btree_node_id_t
+find_leaf(btree_t *tree, btree_key_t key, struct btree_node *node)
+{
+  btree_node_id_t id;
+  int level;
+
+  id = tree->header.root;
+  for(level = 0; level < tree->header.height; level++) {
+    if(node_read(tree, id, node) == 0) {
+      return INVALID_NODE;
+    }
+    if(node->leaf) {
+      return id;
+    }
+    id = node->ptrs[search_node(node, key, 1)];
+  }
+  return INVALID_NODE;
+}
+
+static int
+insert_item(btree_t *tree, btree_key_t key, tuple_id_t value)
+{
+  static struct btree_node node;
+  static struct btree_node sibling;
+  struct btree_header header;
+  btree_node_id_t path[MAX_HEIGHT];
+  uint8_t slots[MAX_HEIGHT];
+  btree_node_id_t id, new_id, root, node_count;
+  btree_key_t split_key;
+  uint32_t ptr;
+  int level, pos, split, is_leaf, splits;
+
+  /* Descend to the leaf, placing the key after any equal keys. The
+     full nodes directly above the leaf split along with it. */
+  id = tree->header.root;
+  splits = 0;
+  for(level = 0;; level++) {
+    if(node_read(tree, id, &node) == 0) {
+      return 0;
+    }
+    path[level] = id;
+    slots[level] = search_node(&node, key, 0);
+    splits = node.count < DB_BTREE_NODE_KEYS ? 0 : splits + 1;
+    if(node.leaf) {
+      break;
+    }
+    id = node.ptrs[slots[level]];
+  }
+
+  /* Reject the key before anything is written if the nodes that a
+     split needs cannot be allocated. A root split needs one more. */
+  if(splits > level) {
+    splits++;
+  }
+  if(tree->header.node_count > INVALID_NODE - splits ||
+     (splits > level && tree->header.height == MAX_HEIGHT)) {
+    PRINTF("DB: The B+-tree is full\n");
+    return 0;
+  }
+
+  /* Insert the key and the tuple ID into the leaf, and then the
+     separator key and the new node into the parent for as long as
+     nodes split. A new node is written before the node that refers to
+     it, and the header is written last, so that a failed write leaves
+     the tree as it was in memory. */
+  node_count = tree->header.node_count;
+  root = tree->header.root;
+  ptr = value;
+  for(;; level--) {
+    pos = slots[level];
+    is_leaf = node.leaf;
+
+    if(node.count < DB_BTREE_NODE_KEYS) {
+      memmove(&node.keys[pos + 1], &node.keys[pos],
+              (node.count - pos) * sizeof(node.keys[0]));
+      if(is_leaf) {
+        memmove(&node.ptrs[pos + 1], &node.ptrs[pos],
+                (node.count - pos) * sizeof(node.ptrs[0]));
+        node.ptrs[pos] = ptr;
+      } else {
+        memmove(&node.ptrs[pos + 2], &node.ptrs[pos + 1],
+                (node.count - pos) * sizeof(node.ptrs[0]));
+        node.ptrs[pos + 1] = ptr;
+      }
+      node.keys[pos] = key;
+      node.count++;
+      if(node_write(tree, path[level], &node) == 0) {
+        return 0;
+      }
+      break;
+    }
+
+    /* The node is full, so half of its keys move to a new node. */
+    new_id = node_count++;
+
+    memset(&sibling, 0, sizeof(sibling));
+    sibling.leaf = is_leaf;
+    split = (DB_BTREE_NODE_KEYS + 1) / 2;
+
+    if(is_leaf) {
+      /* The leaf keeps the first "split" of the DB_BTREE_NODE_KEYS + 1
+         keys, and the first key of the sibling becomes the separator. */
+      if(pos < split) {
+        split--;
+      }
+      sibling.count = node.count - split;
+      memcpy(sibling.keys, &node.keys[split],
+             sibling.count * sizeof(node.keys[0]));
+      memcpy(sibling.ptrs, &node.ptrs[split],
+             sibling.count * sizeof(node.ptrs[0]));
+      node.count = split;
+      sibling.next = node.next;
+      node.next = new_id;
+
+      if(pos <= split) {
+        memmove(&node.keys[pos + 1], &node.keys[pos],
+                (node.count - pos) * sizeof(node.keys[0]));
+        memmove(&node.ptrs[pos + 1], &node.ptrs[pos],
+                (node.count - pos) * sizeof(node.ptrs[0]));
+        node.keys[pos] = key;
+        node.ptrs[pos] = ptr;
+        node.count++;
+      } else {
+        pos -= split;
+        memmove(&sibling.keys[pos + 1], &sibling.keys[pos],
+                (sibling.count - pos) * sizeof(sibling.keys[0]));
+        memmove(&sibling.ptrs[pos + 1], &sibling.ptrs[pos],
+                (sibling.count - pos) * sizeof(sibling.ptrs[0]));
+        sibling.keys[pos] = key;
+        sibling.ptrs[pos] = ptr;
+        sibling.count++;
+      }
+      split_key = sibling.keys[0];
+    } else {
+      /* Insert into the full internal node by shifting the keys and
+         children through the sibling. The middle key moves up. */
+      static btree_key_t keys[DB_BTREE_NODE_KEYS + 1];
+      static uint32_t ptrs[DB_BTREE_NODE_KEYS + 2];
+
+      memcpy(keys, node.keys, pos * sizeof(keys[0]));
+      keys[pos] = key;
+      memcpy(&keys[pos + 1], &node.keys[pos],
+             (node.count - pos) * sizeof(keys[0]));
+      memcpy(ptrs, node.ptrs, (pos + 1) * sizeof(ptrs[0]));
+      ptrs[pos + 1] = ptr;
+      memcpy(&ptrs[pos + 2], &node.ptrs[pos + 1],
+             (node.count - pos) * sizeof(ptrs[0]));
+
+      node.count = split;
+      memcpy(node.keys, keys, split * sizeof(keys[0]));
+      memcpy(node.ptrs, ptrs, (split + 1) * sizeof(ptrs[0]));
+      split_key = keys[split];
+      sibling.count = DB_BTREE_NODE_KEYS - split;
+      memcpy(sibling.keys, &keys[split + 1],
+             sibling.count * sizeof(keys[0]));
+      memcpy(sibling.ptrs, &ptrs[split + 1],
+             (sibling.count + 1) * sizeof(ptrs[0]));
+    }
+
+    if(node_write(tree, new_id, &sibling) == 0) {
+      return 0;
+    }
+
+    key = split_key;
+    ptr = new_id;
+
+    if(level == 0) {
+      /* The root split, so the tree grows by one level. The new root
+         reuses the sibling buffer. */
+      root = node_count++;
+      memset(&sibling, 0, sizeof(sibling));
+      sibling.count = 1;
+      sibling.keys[0] = key;
+      sibling.ptrs[0] = path[0];
+      sibling.ptrs[1] = ptr;
+      if(node_write(tree, root, &sibling) == 0 ||
+         node_write(tree, path[0], &node) == 0) {
+        return 0;
+      }
+      break;
+    }
+
+    if(node_write(tree, path[level], &node) == 0 ||
+       node_read(tree, path[level - 1], &node) == 0) {
+      return 0;
+    }
+  }
+
+  if(node_count == tree->header.node_count) {
+    return 1;
+  }
+
+  header = tree->header;
+  tree->header.node_count = node_count;
+  if(root != tree->header.root) {
+    tree->header.root = root;
+    tree->header.height++;
+  }
+  if(header_write(tree) == 0) {
+    tree->header = header;
+    return 0;
+  }
+  return 1;
+}
+
+static db_result_t
+open_tree(index_t *index)
+{
+  btree_t *tree;
+
+  index->opaque_data = tree = memb_alloc(&btrees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0) {
+    memb_free(&btrees, tree);
+    index->opaque_data = NULL;
+    return DB_STORAGE_ERROR;
+  }
+#if DB_FEATURE_COFFEE
+  /* Nodes are rewritten in place, so Coffee has to use micro logs. */
+  cfs_coffee_set_io_semantics(tree->storage, 0);
+#endif /* DB_FEATURE_COFFEE */
+
+  return DB_OK;
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  btree_t *tree;
+  struct btree_node node;
+
+  filename = storage_generate_file("btree",
+                                   node_offset(DB_BTREE_RESERVE_NODES));
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  if(DB_ERROR(open_tree(index))) {
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_INDEX_ERROR;
+  }
+  tree = index->opaque_data;
+
+  /* Start with a single empty leaf as the root. */
+  tree->header.root = 0;
+  tree->header.node_count = 1;
+  tree->header.height = 1;
+  memset(&node, 0, sizeof(node));
+  node.leaf = 1;
+
+  if(node_write(tree, 0, &node) == 0 || header_write(tree) == 0) {
+    release(index);
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Created a B+-tree index in %s\n", index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  if(index->opaque_data != NULL) {
+    release(index);
+  }
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  btree_t *tree;
+
+  if(DB_ERROR(open_tree(index))) {
+    return DB_STORAGE_ERROR;
+  }
+  tree = index->opaque_data;
+
+  if(DB_ERROR(storage_read(tree->storage, &tree->header, 0,
+                           sizeof(tree->header)))) {
+    release(index);
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Loaded a B+-tree index of height %u from %s\n",
+         (unsigned)tree->header.height, index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  btree_t *tree;
+
+  tree = index->opaque_data;
+  cache_invalidate(tree);
+  storage_close(tree->storage);
+  memb_free(&btrees, tree);
+  index->opaque_data = NULL;
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *key, tuple_id_t value)
+{
+  btree_t *tree;
+
+  tree = (btree_t *)index->opaque_data;
+  if(insert_item(tree, db_value_to_long(key), value) == 0) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n",
+           db_value_to_long(key));
+    return DB_INDEX_ERROR;
+  }
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  static struct btree_node node;
+  btree_t *tree;
+  btree_node_id_t id;
+  btree_key_t key;
+  int pos, end;
+
+  tree = (btree_t *)index->opaque_data;
+  key = db_value_to_long(value);
+
+  /* Remove the key from each leaf that has it, starting from the
+     leftmost one. */
+  id = find_leaf(tree, key, &node);
+  if(id == INVALID_NODE) {
+    return DB_STORAGE_ERROR;
+  }
+  for(;;) {
+    pos = search_node(&node, key, 1);
+    end = search_node(&node, key, 0);
+    if(pos < end) {
+      memmove(&node.keys[pos], &node.keys[end],
+              (node.count - end) * sizeof(node.keys[0]));
+      memmove(&node.ptrs[pos], &node.ptrs[end],
+              (node.count - end) * sizeof(node.ptrs[0]));
+      node.count -= end - pos;
+      if(node_write(tree, id, &node) == 0) {
+        return DB_STORAGE_ERROR;
+      }
+    }
+    if(end < node.count || node.next == NO_NODE) {
+      break;
+    }
+    id = node.next;
+    if(node_read(tree, id, &node) == 0) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+  return DB_OK;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  static struct {
+    index_iterator_t *index_iterator;
+    btree_node_id_t id;
+    uint8_t pos;
+  } cache;
+  static struct btree_node node;
+  btree_t *tree;
+  btree_key_t min, max;
+
+  tree = (btree_t *)iterator->index->opaque_data;
+  min = db_value_to_long(&iterator->min_value);
+  max = db_value_to_long(&iterator->max_value);
+
+  if(cache.index_iterator != iterator || iterator->next_item_no == 0) {
+    /* Find the first key in the range. */
+    cache.index_iterator = iterator;
+    cache.id = find_leaf(tree, min, &node);
+    if(cache.id == INVALID_NODE) {
+      return INVALID_TUPLE;
+    }
+    cache.pos = search_node(&node, min, 1);
+  } else if(node_read(tree, cache.id, &node) == 0) {
+    return INVALID_TUPLE;
+  }
+
+  /* Skip to the next leaf with keys left. */
+  while(cache.pos >= node.count) {
+    if(node.next == NO_NODE) {
+      return INVALID_TUPLE;
+    }
+    cache.id = node.next;
+    cache.pos = 0;
+    if(node_read(tree, cache.id, &node) == 0) {
+      return INVALID_TUPLE;
+    }
+  }
+
+  if(node.keys[cache.pos] > max) {
+    return INVALID_TUPLE;
+  }
+
+  iterator->next_item_no++;
+  return (tuple_id_t)node.ptrs[cache.pos++];
+}
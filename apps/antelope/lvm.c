@@ -66,6 +66,10 @@
 
 #define IS_CONNECTIVE(op) ((op) & LVM_CONNECTIVE)
 
+/* Returned internally when a part of the program cannot be evaluated
+   one column at a time. */
+#define NOT_COLUMNAR	-1
+
 struct variable {
   operand_type_t type;
   operand_value_t value;
@@ -403,6 +407,158 @@ lvm_execute(lvm_instance_t *p)
   return status;
 }
 
+/* Get the values of an operand for all tuples in a batch. The values
+   are stored at an interval of *step in the returned array, and
+   constants have a step of 0. */
+static long *
+get_batch_operand(lvm_instance_t *p, long *columns[], long *constant,
+                  int *step)
+{
+  operand_t operand;
+
+  if(get_type(p) != LVM_OPERAND) {
+    return NULL;
+  }
+  get_operand(p, &operand);
+
+  if(operand.type == LVM_VARIABLE && operand.value.id < LVM_MAX_VARIABLE_ID &&
+     columns[operand.value.id] != NULL) {
+    *step = 1;
+    return columns[operand.value.id];
+  }
+
+  *constant = operand_to_long(&operand);
+  *step = 0;
+  return constant;
+}
+
+#define COMPARE_BATCH(cmp)				\
+  for(i = 0; i < count; i++, v1 += step1, v2 += step2) {	\
+    if(*v1 cmp *v2) {					\
+      *matches |= 1UL << i;				\
+    }							\
+  }
+
+static int
+eval_logic_batch(lvm_instance_t *p, operator_t *op, long *columns[],
+                 unsigned count, unsigned long *matches)
+{
+  int i;
+  int r;
+  operator_t *operator;
+  unsigned long logic_result[2];
+  unsigned arguments;
+  long constant[2];
+  long *v1, *v2;
+  int step1, step2;
+
+  *matches = 0;
+
+  if(IS_CONNECTIVE(*op)) {
+    arguments = *op == LVM_NOT ? 1 : 2;
+    for(i = 0; i < arguments; i++) {
+      if(get_type(p) != LVM_CMP_OP) {
+	return SEMANTIC_ERROR;
+      }
+      operator = get_operator(p);
+      r = eval_logic_batch(p, operator, columns, count, &logic_result[i]);
+      if(r != TRUE) {
+	return r;
+      }
+    }
+
+    if(*op == LVM_NOT) {
+      *matches = ~logic_result[0];
+    } else if(*op == LVM_AND) {
+      *matches = logic_result[0] & logic_result[1];
+    } else {
+      *matches = logic_result[0] | logic_result[1];
+    }
+    return TRUE;
+  }
+
+  /* Only comparisons between attributes and constants are evaluated
+     column-wise. Arithmetic is left to lvm_execute(). */
+  v1 = get_batch_operand(p, columns, &constant[0], &step1);
+  if(v1 == NULL) {
+    return NOT_COLUMNAR;
+  }
+  v2 = get_batch_operand(p, columns, &constant[1], &step2);
+  if(v2 == NULL) {
+    return NOT_COLUMNAR;
+  }
+
+  switch(*op) {
+  case LVM_EQ:
+    COMPARE_BATCH(==);
+    break;
+  case LVM_NEQ:
+    COMPARE_BATCH(!=);
+    break;
+  case LVM_GE:
+    COMPARE_BATCH(>);
+    break;
+  case LVM_GEQ:
+    COMPARE_BATCH(>=);
+    break;
+  case LVM_LE:
+    COMPARE_BATCH(<);
+    break;
+  case LVM_LEQ:
+    COMPARE_BATCH(<=);
+    break;
+  default:
+    return EXECUTION_ERROR;
+  }
+
+  return TRUE;
+}
+
+lvm_status_t
+lvm_execute_batch(lvm_instance_t *p, long *columns[], unsigned count,
+                  lvm_status_t wanted_result, unsigned long *matches)
+{
+  operator_t *operator;
+  unsigned long all;
+  unsigned i;
+  variable_id_t id;
+  int r;
+
+  if(count > LVM_BATCH_LIMIT) {
+    return EXECUTION_ERROR;
+  }
+  all = count == LVM_BATCH_LIMIT ? 0xffffffffUL : (1UL << count) - 1;
+
+  p->ip = 0;
+  if(get_type(p) != LVM_CMP_OP) {
+    PRINTF("Error: The code must start with a relational operator\n");
+    return EXECUTION_ERROR;
+  }
+  operator = get_operator(p);
+  r = eval_logic_batch(p, operator, columns, count, matches);
+  if(r == TRUE) {
+    *matches = (wanted_result == TRUE ? *matches : ~*matches) & all;
+    return TRUE;
+  } else if(r != NOT_COLUMNAR) {
+    return r;
+  }
+
+  /* Evaluate the program for one tuple at a time. */
+  *matches = 0;
+  for(i = 0; i < count; i++) {
+    for(id = 0; id < LVM_MAX_VARIABLE_ID; id++) {
+      if(columns[id] != NULL) {
+	variables[id].value.l = columns[id][i];
+      }
+    }
+    if(lvm_execute(p) == wanted_result) {
+      *matches |= 1UL << i;
+    }
+  }
+
+  return TRUE;
+}
+
 void
 lvm_set_op(lvm_instance_t *p, operator_t op)
 {
@@ -472,6 +628,12 @@ lvm_set_variable_value(char *name, operand_value_t value)
   return TRUE;
 }
 
+variable_id_t
+lvm_get_variable_id(char *name)
+{
+  return lookup(name);
+}
+
 void
 lvm_set_variable(lvm_instance_t *p, char *name)
 {
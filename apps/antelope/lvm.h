@@ -63,6 +63,10 @@ typedef enum lvm_status lvm_status_t;
 
 typedef int lvm_ip_t;
 
+/* The maximum number of tuples evaluated by one call to
+   lvm_execute_batch(). */
+#define LVM_BATCH_LIMIT	32
+
 struct lvm_instance {
   unsigned char *code;
   lvm_ip_t size;
@@ -128,8 +132,12 @@ lvm_status_t lvm_get_derived_range(lvm_instance_t *p, char *name,
                                    operand_value_t *max);
 void lvm_print_derivations(lvm_instance_t *p);
 lvm_status_t lvm_execute(lvm_instance_t *p);
+lvm_status_t lvm_execute_batch(lvm_instance_t *p, long *columns[],
+                               unsigned count, lvm_status_t wanted_result,
+                               unsigned long *matches);
 lvm_status_t lvm_register_variable(char *name, operand_type_t type);
 lvm_status_t lvm_set_variable_value(char *name, operand_value_t value);
+variable_id_t lvm_get_variable_id(char *name);
 void lvm_print_code(lvm_instance_t *p);
 lvm_ip_t lvm_jump_to_operand(lvm_instance_t *p);
 lvm_ip_t lvm_shift_for_operator(lvm_instance_t *p, lvm_ip_t end);
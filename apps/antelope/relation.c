@@ -79,6 +79,25 @@ struct source_map {
 };
 
 static struct source_map source_map[AQL_ATTRIBUTE_LIMIT];
+
+/*
+ * A block of tuples from the left relation, used for joining on an
+ * attribute that is not indexed in the right relation. Each tuple in
+ * the right relation is compared with all the tuples in the block
+ * before the next block is read.
+ */
+struct join_block {
+  tuple_id_t count;
+  tuple_id_t next_match;
+  tuple_id_t right_tuple_id;
+  unsigned left_offset;
+  unsigned right_offset;
+  long right_key;
+  long keys[DB_JOIN_BLOCK_SIZE];
+  unsigned char rows[DB_JOIN_BLOCK_SIZE * DB_MAX_CHAR_SIZE_PER_ROW];
+};
+
+static struct join_block join_block;
 #endif /* DB_FEATURE_JOIN */
 
 static unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
@@ -88,6 +107,63 @@ static unsigned char * const left_row = row;
 static unsigned char * const right_row = extra_row;
 static unsigned char * const join_row = result_row;
 
+#if DB_SCAN_BATCH_SIZE > 1
+#if DB_SCAN_BATCH_SIZE > LVM_BATCH_LIMIT
+#error "DB_SCAN_BATCH_SIZE must not be larger than LVM_BATCH_LIMIT"
+#endif
+
+/*
+ * A batch of tuples read by a full relation scan. The attribute values
+ * used by the selection predicate are decoded into one column per
+ * LVM variable, so that the predicate can be evaluated for the whole
+ * batch at once.
+ */
+struct scan_batch {
+  tuple_id_t start;
+  tuple_id_t count;
+  unsigned long matches;
+  unsigned char rows[DB_SCAN_BATCH_SIZE * DB_MAX_CHAR_SIZE_PER_ROW];
+  long values[LVM_MAX_VARIABLE_ID][DB_SCAN_BATCH_SIZE];
+};
+
+static struct scan_batch batch;
+#endif /* DB_SCAN_BATCH_SIZE > 1 */
+
+/* The number of tuples aggregated by a query without grouping. */
+static unsigned long aggregated_tuples;
+
+#if DB_FEATURE_GROUP
+/*
+ * A GROUP BY query aggregates the matching tuples into a hash table of
+ * groups in RAM. Once the table is full, the tuples of further groups
+ * are stored in a temporary relation. When the groups in RAM have been
+ * emitted, the stored tuples are aggregated in another pass.
+ */
+struct group {
+  long key;
+  unsigned long count;
+  long values[AQL_ATTRIBUTE_LIMIT];
+};
+
+enum {
+  GROUP_SCAN,
+  GROUP_EMIT,
+  GROUP_SCAN_SPILLED,
+  GROUP_DONE
+};
+
+static struct group groups[DB_GROUP_LIMIT];
+
+static struct {
+  relation_t *spill;
+  tuple_id_t next_spilled;
+  tuple_id_t pass_end;
+  uint8_t key;
+  uint8_t next_group;
+  uint8_t state;
+} grouping;
+#endif /* DB_FEATURE_GROUP */
+
 LIST(relations);
 MEMB(relations_memb, relation_t, DB_RELATION_POOL_SIZE);
 MEMB(attributes_memb, attribute_t, DB_ATTRIBUTE_POOL_SIZE);
@@ -548,40 +624,27 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 }
 
 static void
-aggregate(attribute_t *attr, attribute_value_t *value)
+aggregate(aql_aggregator_t aggregator, long *aggregation_value, long value)
 {
-  long long_value;
-
-  switch(value->domain) {
-  case DOMAIN_INT:
-    long_value = VALUE_INT(value);
-    break;
-  case DOMAIN_LONG:
-    long_value = VALUE_LONG(value);
-    break;
-  default:
-    return;
-  }
-
-  switch(attr->aggregator) {
+  switch(aggregator) {
   case AQL_COUNT:
-    attr->aggregation_value++;
+    (*aggregation_value)++;
     break;
   case AQL_SUM:
-    attr->aggregation_value += long_value;
-    break;
   case AQL_MEAN:
+    /* The mean is the sum divided by the tuple count in the end. */
+    *aggregation_value += value;
     break;
   case AQL_MEDIAN:
     break;
   case AQL_MAX:
-    if(long_value > attr->aggregation_value) {
-      attr->aggregation_value = long_value;
+    if(value > *aggregation_value) {
+      *aggregation_value = value;
     }
     break;
   case AQL_MIN:
-    if(long_value < attr->aggregation_value) {
-      attr->aggregation_value = long_value;
+    if(value < *aggregation_value) {
+      *aggregation_value = value;
     }
     break;
   default:
@@ -589,6 +652,29 @@ aggregate(attribute_t *attr, attribute_value_t *value)
   }
 }
 
+static long
+aggregation_start_value(aql_aggregator_t aggregator)
+{
+  switch(aggregator) {
+  case AQL_MAX:
+    return LONG_MIN;
+  case AQL_MIN:
+    return LONG_MAX;
+  default:
+    return 0;
+  }
+}
+
+static long
+aggregation_result(aql_aggregator_t aggregator, long aggregation_value,
+                   unsigned long tuples)
+{
+  if(aggregator == AQL_MEAN) {
+    return tuples == 0 ? 0 : aggregation_value / (long)tuples;
+  }
+  return aggregation_value;
+}
+
 static db_result_t
 generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_count,
                        relation_t *from_rel, relation_t *to_rel, 
@@ -683,6 +769,9 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   handle->current_row = 0;
   handle->ncolumns = 0;
   handle->tuple_id = 0;
+#if DB_SCAN_BATCH_SIZE > 1
+  batch.count = 0;
+#endif /* DB_SCAN_BATCH_SIZE > 1 */
   for(attr = list_head(result_rel->attributes); attr != NULL; attr = attr->next) {
     if(attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
       continue;
@@ -696,7 +785,10 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
-  if(adt->lvm_instance != NULL) {
+  /* A removal keeps the tuples that do not match the condition, so it
+     cannot be limited to the tuples that an index finds. */
+  if(adt->lvm_instance != NULL &&
+     !(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC)) {
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
       select_index(handle, adt->lvm_instance);
@@ -708,6 +800,335 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   return DB_OK;
 }
 
+static long
+attribute_to_long(attribute_t *attr, unsigned char *ptr)
+{
+  if(attr->domain == DOMAIN_INT) {
+    return ptr[0] << 8 | ptr[1];
+  }
+  return (uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+         (uint32_t)ptr[2] << 8 | ptr[3];
+}
+
+static void
+long_to_attribute(attribute_t *attr, unsigned char *ptr, long value)
+{
+  if(attr->domain == DOMAIN_INT) {
+    ptr[0] = value >> 8;
+    ptr[1] = value & 0xff;
+    return;
+  }
+  ptr[0] = value >> 24;
+  ptr[1] = value >> 16;
+  ptr[2] = value >> 8;
+  ptr[3] = value & 0xff;
+}
+
+#if DB_SCAN_BATCH_SIZE > 1
+static db_result_t
+read_batch(db_handle_t *handle, aql_adt_t *adt, lvm_status_t wanted_result)
+{
+  db_result_t result;
+  struct source_dest_map *attr_map_ptr, *attr_map_end;
+  long *columns[LVM_MAX_VARIABLE_ID];
+  variable_id_t id;
+  tuple_id_t i;
+  size_t row_length;
+  unsigned char *from_ptr;
+
+  row_length = handle->rel->row_length;
+  batch.start = handle->tuple_id;
+  batch.count = sizeof(batch.rows) / row_length;
+  if(batch.count > DB_SCAN_BATCH_SIZE) {
+    batch.count = DB_SCAN_BATCH_SIZE;
+  }
+
+  result = storage_get_rows(handle->rel, &batch.start, batch.rows,
+                            &batch.count);
+  if(result != DB_OK) {
+    batch.count = 0;
+    return result;
+  }
+
+  if(adt->lvm_instance == NULL) {
+    batch.matches = ~0UL;
+    return DB_OK;
+  }
+
+  /* Decode the values of the attributes that the predicate uses. */
+  memset(columns, 0, sizeof(columns));
+  attr_map_end = attr_map + handle->result_rel->attribute_count;
+  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+    if(attr_map_ptr->from_attr->domain != DOMAIN_INT &&
+       attr_map_ptr->from_attr->domain != DOMAIN_LONG) {
+      continue;
+    }
+    id = lvm_get_variable_id(attr_map_ptr->to_attr->name);
+    if(id >= LVM_MAX_VARIABLE_ID) {
+      continue;
+    }
+
+    columns[id] = batch.values[id];
+    from_ptr = batch.rows + attr_map_ptr->from_offset;
+    for(i = 0; i < batch.count; i++, from_ptr += row_length) {
+      batch.values[id][i] = attribute_to_long(attr_map_ptr->from_attr,
+                                              from_ptr);
+    }
+  }
+
+  if(LVM_ERROR(lvm_execute_batch(adt->lvm_instance, columns, batch.count,
+                                 wanted_result, &batch.matches))) {
+    batch.matches = 0;
+  }
+
+  return DB_OK;
+}
+#endif /* DB_SCAN_BATCH_SIZE > 1 */
+
+#if DB_FEATURE_GROUP
+static db_result_t
+group_start(db_handle_t *handle)
+{
+  struct source_dest_map *attr_map_ptr, *attr_map_end;
+
+  if(grouping.spill != NULL) {
+    /* The previous GROUP BY query was not processed to the end. */
+    relation_release(grouping.spill);
+    grouping.spill = NULL;
+  }
+
+  attr_map_end = attr_map + handle->result_rel->attribute_count;
+  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+    if(attr_map_ptr->to_attr->flags & ATTRIBUTE_FLAG_GROUP) {
+      break;
+    }
+  }
+
+  if(attr_map_ptr == attr_map_end) {
+    return DB_IMPLEMENTATION_ERROR;
+  }
+
+  if(attr_map_ptr->from_attr->domain != DOMAIN_INT &&
+     attr_map_ptr->from_attr->domain != DOMAIN_LONG) {
+    PRINTF("DB: Cannot group by attribute %s\n", attr_map_ptr->to_attr->name);
+    return DB_TYPE_ERROR;
+  }
+
+  memset(groups, 0, sizeof(groups));
+  grouping.key = attr_map_ptr - attr_map;
+  grouping.next_group = 0;
+  grouping.next_spilled = 0;
+  grouping.pass_end = 0;
+  grouping.state = GROUP_SCAN;
+
+  return DB_OK;
+}
+
+static void
+group_end(void)
+{
+  grouping.state = GROUP_DONE;
+  if(grouping.spill != NULL) {
+    relation_release(grouping.spill);
+    grouping.spill = NULL;
+    relation_remove(GROUP_RELATION, 1);
+  }
+}
+
+static struct group *
+group_find(long key, unsigned attribute_count)
+{
+  struct group *group;
+  unsigned i, j;
+  unsigned probes;
+
+  i = (unsigned long)key % DB_GROUP_LIMIT;
+  for(probes = 0; probes < DB_GROUP_LIMIT; probes++) {
+    group = &groups[i];
+    if(group->count == 0) {
+      group->key = key;
+      for(j = 0; j < attribute_count; j++) {
+        group->values[j] =
+          aggregation_start_value(attr_map[j].to_attr->aggregator);
+      }
+      return group;
+    } else if(group->key == key) {
+      return group;
+    }
+
+    if(++i == DB_GROUP_LIMIT) {
+      i = 0;
+    }
+  }
+
+  return NULL;
+}
+
+static db_result_t
+group_spill(long *values, unsigned attribute_count)
+{
+  attribute_t *attr;
+  unsigned char *ptr;
+  unsigned i;
+
+  if(grouping.spill == NULL) {
+    PRINTF("DB: Storing the tuples of groups that do not fit in RAM\n");
+    relation_remove(GROUP_RELATION, 1);
+    if(relation_create(GROUP_RELATION, DB_STORAGE) == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+    grouping.spill = relation_load(GROUP_RELATION);
+    if(grouping.spill == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+
+    for(i = 0; i < attribute_count; i++) {
+      if(relation_attribute_add(grouping.spill, DB_STORAGE,
+                                attr_map[i].to_attr->name,
+                                DOMAIN_LONG, 4) == NULL) {
+        return DB_ALLOCATION_ERROR;
+      }
+    }
+  }
+
+  ptr = extra_row;
+  for(attr = list_head(grouping.spill->attributes);
+      attr != NULL;
+      attr = attr->next) {
+    long_to_attribute(attr, ptr, *values++);
+    ptr += attr->element_size;
+  }
+
+  return storage_put_row(grouping.spill, extra_row);
+}
+
+static db_result_t
+group_add(db_handle_t *handle, long *values)
+{
+  struct group *group;
+  unsigned attribute_count;
+  unsigned i;
+
+  attribute_count = handle->result_rel->attribute_count;
+
+  group = group_find(values[grouping.key], attribute_count);
+  if(group == NULL) {
+    return group_spill(values, attribute_count);
+  }
+
+  group->count++;
+  for(i = 0; i < attribute_count; i++) {
+    aggregate(attr_map[i].to_attr->aggregator, &group->values[i], values[i]);
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+group_emit(db_handle_t *handle)
+{
+  struct group *group;
+  attribute_t *to_attr;
+  unsigned attribute_count;
+  unsigned i;
+  long value;
+
+  attribute_count = handle->result_rel->attribute_count;
+
+  while(grouping.next_group < DB_GROUP_LIMIT) {
+    group = &groups[grouping.next_group++];
+    if(group->count == 0) {
+      continue;
+    }
+
+    for(i = 0; i < attribute_count; i++) {
+      to_attr = attr_map[i].to_attr;
+      if(to_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+        continue;
+      }
+
+      if(i == grouping.key) {
+        value = group->key;
+      } else {
+        value = aggregation_result(to_attr->aggregator, group->values[i],
+                                   group->count);
+      }
+      long_to_attribute(to_attr, result_row + attr_map[i].to_offset, value);
+    }
+
+    if(AQL_GET_FLAGS((aql_adt_t *)handle->adt) & AQL_FLAG_ASSIGN) {
+      if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+        PRINTF("DB: Failed to store a row in the result relation!\n");
+        return DB_STORAGE_ERROR;
+      }
+    }
+    handle->current_row++;
+    return DB_GOT_ROW;
+  }
+
+  return DB_FINISHED;
+}
+
+static db_result_t
+group_process(db_handle_t *handle)
+{
+  long values[AQL_ATTRIBUTE_LIMIT];
+  attribute_t *attr;
+  unsigned char *ptr;
+  db_result_t result;
+  unsigned i;
+
+  switch(grouping.state) {
+  case GROUP_EMIT:
+    result = group_emit(handle);
+    if(result != DB_FINISHED) {
+      return result;
+    }
+
+    /* All groups in RAM have been emitted. Aggregate the stored tuples
+       of the remaining groups, if there are any. */
+    memset(groups, 0, sizeof(groups));
+    grouping.next_group = 0;
+    if(grouping.spill != NULL) {
+      if(DB_ERROR(storage_get_row_amount(grouping.spill,
+                                         &grouping.pass_end))) {
+        return DB_STORAGE_ERROR;
+      }
+      if(grouping.next_spilled < grouping.pass_end) {
+        grouping.state = GROUP_SCAN_SPILLED;
+        return DB_OK;
+      }
+    }
+    group_end();
+    return DB_FINISHED;
+  case GROUP_SCAN_SPILLED:
+    /* The tuples stored during this pass are left for the next one. */
+    if(grouping.next_spilled == grouping.pass_end) {
+      grouping.state = GROUP_EMIT;
+      return DB_OK;
+    }
+
+    result = storage_get_row(grouping.spill, &grouping.next_spilled, row);
+    grouping.next_spilled++;
+    if(result != DB_OK) {
+      return DB_STORAGE_ERROR;
+    }
+
+    ptr = row;
+    for(i = 0, attr = list_head(grouping.spill->attributes);
+        attr != NULL;
+        i++, attr = attr->next) {
+      values[i] = attribute_to_long(attr, ptr);
+      ptr += attr->element_size;
+    }
+
+    return group_add(handle, values);
+  default:
+    return DB_FINISHED;
+  }
+}
+#endif /* DB_FEATURE_GROUP */
+
 #if DB_FEATURE_REMOVE
 db_result_t
 relation_process_remove(void *handle_ptr)
@@ -740,19 +1161,60 @@ relation_process_select(void *handle_ptr)
   unsigned attribute_count;
   struct source_dest_map *attr_map_ptr, *attr_map_end;
   attribute_t *result_attr;
-  unsigned char *from_ptr;
-  unsigned char *to_ptr;
+  attribute_t *from_attr;
+  unsigned char *from_row;
   operand_value_t operand_value;
-  uint8_t intbuf[2];
-  attribute_value_t value;
+  long values[AQL_ATTRIBUTE_LIMIT];
+  unsigned i;
   lvm_status_t wanted_result;
+#if DB_SCAN_BATCH_SIZE > 1
+  tuple_id_t batch_index;
+#endif /* DB_SCAN_BATCH_SIZE > 1 */
 
   handle = (db_handle_t *)handle_ptr;
   adt = (aql_adt_t *)handle->adt;
 
+#if DB_FEATURE_GROUP
+  if((AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) && grouping.state != GROUP_SCAN) {
+    return group_process(handle);
+  }
+#endif /* DB_FEATURE_GROUP */
+
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
+  wanted_result = TRUE;
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) {
+    wanted_result = FALSE;
+  }
+
+#if DB_SCAN_BATCH_SIZE > 1
+  if(!(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX)) {
+    /* Scan the relation a batch of tuples at a time. */
+    if(handle->tuple_id < batch.start ||
+       handle->tuple_id >= batch.start + batch.count) {
+      result = read_batch(handle, adt, wanted_result);
+      if(DB_ERROR(result)) {
+        PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
+        return result;
+      } else if(result == DB_FINISHED) {
+        if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+          goto end_aggregation;
+        }
+        return DB_FINISHED;
+      }
+    }
+
+    batch_index = handle->tuple_id - batch.start;
+    handle->tuple_id++;
+    if(!(batch.matches & (1UL << batch_index))) {
+      return DB_OK;
+    }
+    from_row = batch.rows + batch_index * handle->rel->row_length;
+    goto matched;
+  }
+#endif /* DB_SCAN_BATCH_SIZE > 1 */
+
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
@@ -783,77 +1245,96 @@ relation_process_select(void *handle_ptr)
     return DB_FINISHED;
   }
 
-  /* Process the attributes in the result relation. */
-  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-    from_ptr = row + attr_map_ptr->from_offset;
-    result_attr = attr_map_ptr->to_attr;
+  from_row = row;
 
-    /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
-      operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
-      operand_value.l = (uint32_t)from_ptr[0] << 24 |
-                        (uint32_t)from_ptr[1] << 16 |
-                        (uint32_t)from_ptr[2] << 8 |
-                        from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+  if(adt->lvm_instance != NULL) {
+    /* Update the internal state of the PLE. The values are decoded
+       in the domain of the source attribute, because an aggregated
+       result attribute has a domain of its own. */
+    for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+      from_attr = attr_map_ptr->from_attr;
+      if(from_attr->domain == DOMAIN_INT ||
+         from_attr->domain == DOMAIN_LONG) {
+        operand_value.l = attribute_to_long(from_attr,
+                                            row + attr_map_ptr->from_offset);
+        lvm_set_variable_value(attr_map_ptr->to_attr->name, operand_value);
+      }
     }
 
-    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
-      /* The attribute is used just for the predicate,
-         so do not copy the current value into the result. */
-      continue;
+    /* Check whether the given predicate is true for this tuple. */
+    if(lvm_execute(adt->lvm_instance) != wanted_result) {
+      return DB_OK;
     }
+  }
 
-    if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE)) {
-      /* No aggregators. Copy the original value into the resulting tuple. */
-      memcpy(result_row + attr_map_ptr->to_offset, from_ptr,
-             result_attr->element_size);
+#if DB_SCAN_BATCH_SIZE > 1
+matched:
+#endif /* DB_SCAN_BATCH_SIZE > 1 */
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+    for(i = 0; i < attribute_count; i++) {
+      values[i] = 0;
+      if(attr_map[i].from_attr->domain == DOMAIN_INT ||
+         attr_map[i].from_attr->domain == DOMAIN_LONG) {
+        values[i] = attribute_to_long(attr_map[i].from_attr,
+                                      from_row + attr_map[i].from_offset);
+      }
     }
-  }
 
-  wanted_result = TRUE;
-  if(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC) {
-    wanted_result = FALSE;
+#if DB_FEATURE_GROUP
+    if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+      return group_add(handle, values);
+    }
+#endif /* DB_FEATURE_GROUP */
+
+    aggregated_tuples++;
+    for(i = 0; i < attribute_count; i++) {
+      result_attr = attr_map[i].to_attr;
+      aggregate(result_attr->aggregator, &result_attr->aggregation_value,
+                values[i]);
+    }
+    return DB_OK;
   }
 
-  /* Check whether the given predicate is true for this tuple. */
-  if(adt->lvm_instance == NULL ||
-     lvm_execute(adt->lvm_instance) == wanted_result) {
-    if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
-      for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-        from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
-        if(DB_ERROR(result)) {
-	  return result;
-        }
-        aggregate(attr_map_ptr->to_attr, &value);
-      }
-    } else {
-      if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
-          PRINTF("DB: Failed to store a row in the result relation!\n");
-          return DB_STORAGE_ERROR;
-        }
-      }
-      handle->current_row++;
-      return DB_GOT_ROW;
+  /* No aggregators. Copy the projected attribute values into the
+     resulting tuple. Attributes that are used just for the predicate
+     are not copied. */
+  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+    if(!(attr_map_ptr->to_attr->flags & ATTRIBUTE_FLAG_NO_STORE)) {
+      memcpy(result_row + attr_map_ptr->to_offset,
+             from_row + attr_map_ptr->from_offset,
+             attr_map_ptr->to_attr->element_size);
     }
   }
 
-  return DB_OK;
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+      PRINTF("DB: Failed to store a row in the result relation!\n");
+      return DB_STORAGE_ERROR;
+    }
+  }
+  handle->current_row++;
+  return DB_GOT_ROW;
 
 end_aggregation:
+#if DB_FEATURE_GROUP
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+    /* Start emitting the aggregated groups. */
+    grouping.state = GROUP_EMIT;
+    return group_process(handle);
+  }
+#endif /* DB_FEATURE_GROUP */
+
   /* Generate aggregated result if requested. */
   for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
     result_attr = attr_map_ptr->to_attr;
-    to_ptr = result_row + attr_map_ptr->to_offset;
+    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+      continue;
+    }
 
-    intbuf[0] = result_attr->aggregation_value >> 8;
-    intbuf[1] = result_attr->aggregation_value & 0xff;
-    from_ptr = intbuf;
-    memcpy(to_ptr, from_ptr, result_attr->element_size);
+    long_to_attribute(result_attr, result_row + attr_map_ptr->to_offset,
+                      aggregation_result(result_attr->aggregator,
+                                         result_attr->aggregation_value,
+                                         aggregated_tuples));
   }
 
   if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
@@ -880,6 +1361,7 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
   attribute_t *attr;
   int i;
   int normal_attributes;
+  db_result_t result;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -916,10 +1398,11 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     PRINTF("DB: Found attribute %s in relation %s\n",
 	attribute_name, rel->name);
 
+    /* Aggregated values are stored in the long domain. */
     attr = relation_attribute_add(handle->result_rel, dir,
 				  attribute_name, 
-				  adt->aggregators[i] ? DOMAIN_INT : attr->domain,
-				  attr->element_size);
+				  adt->aggregators[i] ? DOMAIN_LONG : attr->domain,
+				  adt->aggregators[i] ? 4 : attr->element_size);
     if(attr == NULL) {
       PRINTF("DB: Failed to add a result attribute\n");
       relation_release(handle->result_rel);
@@ -927,22 +1410,13 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     }
 
     attr->aggregator = adt->aggregators[i];
-    switch(attr->aggregator) {
-    case AQL_NONE:
-      if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE)) {
-        /* Only count attributes projected into the result set. */
-        normal_attributes++;
-      }
-      break;
-    case AQL_MAX:
-      attr->aggregation_value = LONG_MIN;
-      break;
-    case AQL_MIN:
-      attr->aggregation_value = LONG_MAX;
-      break;
-    default:
-      attr->aggregation_value = 0;
-      break;
+    attr->aggregation_value = aggregation_start_value(attr->aggregator);
+    if(attr->aggregator == AQL_NONE &&
+       !(adt->attributes[i].flags &
+         (ATTRIBUTE_FLAG_NO_STORE | ATTRIBUTE_FLAG_GROUP))) {
+      /* Only count attributes projected into the result set. A grouping
+         attribute can be projected along with the aggregated ones. */
+      normal_attributes++;
     }
 
     attr->flags = adt->attributes[i].flags;
@@ -955,10 +1429,110 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
      return DB_RELATIONAL_ERROR;
   }
 
-  return generate_selection_result(handle, rel, adt);
+  aggregated_tuples = 0;
+  result = generate_selection_result(handle, rel, adt);
+
+#if DB_FEATURE_GROUP
+  if(!DB_ERROR(result) && (AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP)) {
+    result = group_start(handle);
+  }
+#endif /* DB_FEATURE_GROUP */
+
+  return result;
 }
 
 #if DB_FEATURE_JOIN
+static db_result_t
+put_join_row(db_handle_t *handle)
+{
+  unsigned char *join_next_attribute_ptr;
+  size_t element_size;
+  int i;
+
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
+
+  for(i = 0; i < handle->join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
+
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
+
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(handle->join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
+static db_result_t
+process_block_join(db_handle_t *handle)
+{
+  relation_t *left_rel;
+  relation_t *right_rel;
+  db_result_t result;
+  unsigned char *ptr;
+  tuple_id_t i;
+
+  left_rel = handle->left_rel;
+  right_rel = handle->right_rel;
+
+  if(join_block.next_match == join_block.count) {
+    if(join_block.count == 0) {
+      /* Read the next block of tuples from the left relation. */
+      join_block.count = sizeof(join_block.rows) / left_rel->row_length;
+      if(join_block.count > DB_JOIN_BLOCK_SIZE) {
+        join_block.count = DB_JOIN_BLOCK_SIZE;
+      }
+
+      result = storage_get_rows(left_rel, &handle->tuple_id,
+                                join_block.rows, &join_block.count);
+      if(result != DB_OK) {
+        join_block.count = 0;
+        return result;
+      }
+      handle->tuple_id += join_block.count;
+
+      ptr = join_block.rows + join_block.left_offset;
+      for(i = 0; i < join_block.count; i++, ptr += left_rel->row_length) {
+        join_block.keys[i] = attribute_to_long(handle->left_join_attr, ptr);
+      }
+      join_block.right_tuple_id = 0;
+    }
+
+    /* Compare the next tuple in the right relation with the block. */
+    result = storage_get_row(right_rel, &join_block.right_tuple_id, right_row);
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to get a row in right relation %s!\n", right_rel->name);
+      return result;
+    } else if(result == DB_FINISHED) {
+      /* The right relation has been joined with this block. */
+      join_block.count = join_block.next_match = 0;
+      return DB_OK;
+    }
+    join_block.right_tuple_id++;
+    join_block.right_key = attribute_to_long(handle->right_join_attr,
+                                             right_row + join_block.right_offset);
+    join_block.next_match = 0;
+  }
+
+  while(join_block.next_match < join_block.count) {
+    i = join_block.next_match++;
+    if(join_block.keys[i] == join_block.right_key) {
+      memcpy(left_row, join_block.rows + i * left_rel->row_length,
+             left_rel->row_length);
+      return put_join_row(handle);
+    }
+  }
+
+  return DB_OK;
+}
+
 db_result_t
 relation_process_join(void *handle_ptr)
 {
@@ -966,17 +1540,16 @@ relation_process_join(void *handle_ptr)
   db_result_t result;
   relation_t *left_rel;
   relation_t *right_rel;
-  relation_t *join_rel;
-  unsigned char *join_next_attribute_ptr;
-  size_t element_size;
   tuple_id_t right_tuple_id;
   attribute_value_t value;
-  int i;
 
   handle = (db_handle_t *)handle_ptr;
   left_rel = handle->left_rel;
   right_rel = handle->right_rel;
-  join_rel = handle->join_rel;
+
+  if(handle->flags & DB_HANDLE_FLAG_BLOCK_JOIN) {
+    return process_block_join(handle);
+  }
 
   if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
     goto inner_loop;
@@ -1030,25 +1603,7 @@ inner_loop:
         return DB_IMPLEMENTATION_ERROR;
       }
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
-
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
-
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
-      }
-
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
-          return DB_STORAGE_ERROR;
-        }
-      }
-
-      handle->current_row++;
-      return DB_GOT_ROW;
+      return put_join_row(handle);
     }
   }
 
@@ -1159,8 +1714,28 @@ relation_join(void *query_result, void *adt_ptr)
   }
 
   if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
+    /* Join blocks of tuples from the left relation with scans of the
+       right relation instead. */
+    if((handle->left_join_attr->domain != DOMAIN_INT &&
+        handle->left_join_attr->domain != DOMAIN_LONG) ||
+       (handle->right_join_attr->domain != DOMAIN_INT &&
+        handle->right_join_attr->domain != DOMAIN_LONG)) {
+      PRINTF("DB: The attribute to join on is neither indexed nor numeric\n");
+      return DB_INDEX_ERROR;
+    }
+
+    if(left_rel->row_length > sizeof(join_block.rows)) {
+      PRINTF("DB: The tuples of relation %s are too large to join in blocks\n",
+             left_rel->name);
+      return DB_LIMIT_ERROR;
+    }
+
+    join_block.count = join_block.next_match = 0;
+    join_block.left_offset = get_attribute_value_offset(left_rel,
+                                                        handle->left_join_attr);
+    join_block.right_offset = get_attribute_value_offset(right_rel,
+                                                         handle->right_join_attr);
+    handle->flags |= DB_HANDLE_FLAG_BLOCK_JOIN;
   }
 
   /*
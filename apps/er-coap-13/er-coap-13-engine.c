@@ -208,6 +208,26 @@ coap_receive(void)
             /* Serialize response. */
             if (coap_error_code==NO_ERROR)
             {
+#if COAP_ZERO_COPY
+              /* Responses that are not retransmitted are sent straight from the uIP buffer,
+               * unless the payload still points into the request. */
+              if (response->type!=COAP_TYPE_CON && (response->payload < uip_buf || response->payload >= uip_buf + UIP_BUFSIZE))
+              {
+                size_t length;
+
+                if ((length = coap_serialize_message(response, COAP_SEND_BUF))==0)
+                {
+                  coap_error_code = PACKET_SERIALIZATION_ERROR;
+                }
+                else
+                {
+                  coap_send_message(&transaction->addr, transaction->port, COAP_SEND_BUF, length);
+                  coap_clear_transaction(transaction);
+                  transaction = NULL;
+                }
+              }
+              else
+#endif /* COAP_ZERO_COPY */
               if ((transaction->packet_len = coap_serialize_message(response, transaction->packet))==0)
               {
                 coap_error_code = PACKET_SERIALIZATION_ERROR;
@@ -246,7 +266,12 @@ coap_receive(void)
           coap_remove_observer_by_mid(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, message->mid);
         }
 
-        if ( (transaction = coap_get_transaction_by_mid(message->mid)) )
+        if ( (message->type==COAP_TYPE_CON || message->type==COAP_TYPE_NON) && message->code!=0
+             && coap_async_receive(message, &UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport) )
+        {
+          /* Separate response to an asynchronous request, matched by Token. */
+        }
+        else if ( (transaction = coap_get_transaction_by_mid(message->mid)) )
         {
           /* Free transaction memory before callback, as it may create a new transaction. */
           restful_response_handler callback = transaction->callback;
@@ -617,6 +642,356 @@ void coap_simple_request(uip_ipaddr_t *addr, uint16_t port, coap_packet_t *reque
 	coap_send_message(addr, uip_htons(port), &packet, packet_len);
 }
 /*----------------------------------------------------------------------------*/
+/*- Asynchronous client ------------------------------------------------------*/
+/*----------------------------------------------------------------------------*/
+/* A request or block request that is in flight */
+typedef struct coap_exchange {
+  struct coap_exchange *next; /* for LIST */
+
+  struct coap_async_request *owner;
+  coap_transaction_t *transaction; /* NULL while waiting for a separate response */
+  struct ctimer separate_timer;
+  uint32_t block_num;
+  uint8_t token[COAP_ASYNC_TOKEN_LEN];
+} coap_exchange_t;
+
+MEMB(exchanges_memb, coap_exchange_t, COAP_MAX_OPEN_EXCHANGES);
+LIST(exchanges_list);
+LIST(async_list);
+
+static uint32_t async_token = 0;
+static struct ctimer async_retry_timer;
+
+static void async_schedule(void);
+/*----------------------------------------------------------------------------*/
+static void
+exchange_free(coap_exchange_t *ex)
+{
+  if (ex->transaction)
+  {
+    coap_clear_transaction(ex->transaction);
+  }
+  else
+  {
+    ctimer_stop(&ex->separate_timer);
+  }
+  --(ex->owner->in_flight);
+  list_remove(exchanges_list, ex);
+  memb_free(&exchanges_memb, ex);
+}
+/*----------------------------------------------------------------------------*/
+static void
+async_cancel_blocks(struct coap_async_request *state, uint32_t from_block)
+{
+  coap_exchange_t *ex = (coap_exchange_t *) list_head(exchanges_list);
+  coap_exchange_t *next;
+
+  for (; ex; ex = next)
+  {
+    next = ex->next;
+    if (ex->owner==state && ex->block_num>=from_block)
+    {
+      exchange_free(ex);
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void
+async_finish(struct coap_async_request *state, coap_async_status_t status, void *response)
+{
+  async_cancel_blocks(state, 0);
+  list_remove(async_list, state);
+
+  state->status = status;
+  state->handler(state, response);
+}
+/*----------------------------------------------------------------------------*/
+static void
+exchange_response(coap_exchange_t *ex, coap_packet_t *response)
+{
+  struct coap_async_request *state = ex->owner;
+  uint32_t num = ex->block_num;
+  uint32_t res_num = 0;
+  uint8_t more = 0;
+  uint16_t size = REST_MAX_CHUNK_SIZE;
+
+  exchange_free(ex);
+
+  if (response==NULL)
+  {
+    PRINTF("Server not responding\n");
+    async_finish(state, COAP_ASYNC_FAILED, NULL);
+    return;
+  }
+
+  coap_get_header_block2(response, &res_num, &more, &size, NULL);
+
+  if (num>0 && response->code>=BAD_REQUEST_4_00 && num>=state->min_blocks)
+  {
+    /* Requested beyond the last block before it was known. */
+    PRINTF("No block %lu\n", num);
+    if (num<state->end_block) state->end_block = num;
+    return;
+  }
+
+  if (res_num!=num || (num>0 && response->code>=BAD_REQUEST_4_00) || (more && num+1>=state->end_block))
+  {
+    PRINTF("WRONG BLOCK %lu/%lu\n", res_num, num);
+    async_finish(state, COAP_ASYNC_FAILED, NULL);
+    return;
+  }
+
+  ++(state->received);
+
+  if (more)
+  {
+    if (num==0)
+    {
+      /* Request the remaining blocks in parallel; a smaller block size renumbers them. */
+      state->blockwise = 1;
+      state->block_size = MIN(size, REST_MAX_CHUNK_SIZE);
+      num = size / state->block_size - 1;
+      state->next_block = num+1;
+      state->received = num+1;
+    }
+    if (num+2>state->min_blocks) state->min_blocks = num+2;
+  }
+  else
+  {
+    state->last_known = 1;
+    state->end_block = num+1;
+    async_cancel_blocks(state, num+1);
+  }
+
+  if (state->last_known && state->received==state->end_block)
+  {
+    async_finish(state, COAP_ASYNC_DONE, response);
+  }
+  else
+  {
+    state->handler(state, response);
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void
+separate_timeout(void *ptr)
+{
+  exchange_response((coap_exchange_t *) ptr, NULL);
+  async_schedule();
+}
+/*----------------------------------------------------------------------------*/
+static void
+exchange_callback(void *callback_data, void *response)
+{
+  coap_exchange_t *ex = (coap_exchange_t *) callback_data;
+  coap_packet_t *const coap_res = (coap_packet_t *) response;
+
+  /* The transaction was cleared before the callback. */
+  ex->transaction = NULL;
+
+  if (coap_res && coap_res->type==COAP_TYPE_ACK && coap_res->code==0)
+  {
+    PRINTF("Waiting for separate response\n");
+    ctimer_set(&ex->separate_timer, COAP_SEPARATE_RESPONSE_TIMEOUT * CLOCK_SECOND, separate_timeout, ex);
+    return;
+  }
+
+  exchange_response(ex, coap_res && coap_res->type!=COAP_TYPE_RST ? coap_res : NULL);
+  async_schedule();
+}
+/*----------------------------------------------------------------------------*/
+static int
+exchange_start(struct coap_async_request *state)
+{
+  /* Copy, as parallel requests may share the caller's request. */
+  static coap_packet_t request[1];
+  coap_exchange_t *ex;
+
+  if ((ex = memb_alloc(&exchanges_memb))==NULL)
+  {
+    return 0;
+  }
+  if ((ex->transaction = coap_new_transaction(coap_get_mid(), &state->addr, state->port))==NULL)
+  {
+    memb_free(&exchanges_memb, ex);
+    return 0;
+  }
+
+  ex->owner = state;
+  ex->block_num = state->next_block;
+  ex->transaction->callback = exchange_callback;
+  ex->transaction->callback_data = ex;
+
+  /* Tokens demultiplex the responses of parallel requests. */
+  ++async_token;
+  ex->token[0] = (uint8_t) (async_token>>24);
+  ex->token[1] = (uint8_t) (async_token>>16);
+  ex->token[2] = (uint8_t) (async_token>>8);
+  ex->token[3] = (uint8_t) (async_token);
+
+  memcpy(request, state->request, sizeof(coap_packet_t));
+  request->mid = ex->transaction->mid;
+  coap_set_header_token(request, ex->token, COAP_ASYNC_TOKEN_LEN);
+  if (state->blockwise)
+  {
+    coap_set_header_block2(request, ex->block_num, 0, state->block_size);
+  }
+
+  if ((ex->transaction->packet_len = coap_serialize_message(request, ex->transaction->packet))==0)
+  {
+    coap_clear_transaction(ex->transaction);
+    memb_free(&exchanges_memb, ex);
+    return 0;
+  }
+
+  list_add(exchanges_list, ex);
+  ++(state->in_flight);
+  ++(state->next_block);
+
+  PRINTF("Requested #%lu (MID %u)\n", ex->block_num, request->mid);
+  coap_send_transaction(ex->transaction);
+
+  if (request->type!=COAP_TYPE_CON)
+  {
+    /* The transaction was freed after sending, wait for the response Token. */
+    ex->transaction = NULL;
+    ctimer_set(&ex->separate_timer, COAP_SEPARATE_RESPONSE_TIMEOUT * CLOCK_SECOND, separate_timeout, ex);
+  }
+
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+static int
+server_in_flight(uip_ipaddr_t *addr, uint16_t port)
+{
+  coap_exchange_t *ex;
+  int n = 0;
+
+  for (ex = (coap_exchange_t *) list_head(exchanges_list); ex; ex = ex->next)
+  {
+    if (ex->owner->port==port && uip_ipaddr_cmp(&ex->owner->addr, addr))
+    {
+      ++n;
+    }
+  }
+  return n;
+}
+/*----------------------------------------------------------------------------*/
+static void
+async_retry(void *ptr)
+{
+  async_schedule();
+}
+/*----------------------------------------------------------------------------*/
+static void
+async_schedule(void)
+{
+  struct coap_async_request *state;
+  int started;
+
+  /* Start one request per round and requester to share the servers' NSTART fairly. */
+  do
+  {
+    started = 0;
+    for (state = (struct coap_async_request *) list_head(async_list); state; state = state->next)
+    {
+      if ((state->next_block==0 || (state->blockwise && state->next_block<state->end_block))
+          && server_in_flight(&state->addr, state->port)<COAP_NSTART)
+      {
+        if (!exchange_start(state))
+        {
+          /* Transactions may be freed without a response for us, so try again later. */
+          PRINTF("Could not allocate exchange\n");
+          ctimer_set(&async_retry_timer, CLOCK_SECOND/8, async_retry, NULL);
+          return;
+        }
+        started = 1;
+      }
+    }
+  } while (started);
+}
+/*----------------------------------------------------------------------------*/
+int
+coap_async_request(struct coap_async_request *state, uip_ipaddr_t *addr, uint16_t port,
+                   coap_packet_t *request, coap_async_handler handler, void *data)
+{
+  if (async_token==0)
+  {
+    async_token = (uint32_t) random_rand()<<16 | random_rand();
+  }
+
+  uip_ipaddr_copy(&state->addr, addr);
+  state->port = port;
+  state->request = request;
+  state->handler = handler;
+  state->data = data;
+  state->status = COAP_ASYNC_PENDING;
+  state->in_flight = 0;
+  state->blockwise = 0;
+  state->last_known = 0;
+  state->block_size = REST_MAX_CHUNK_SIZE;
+  state->next_block = 0;
+  state->end_block = 0xFFFFFFFF;
+  state->min_blocks = 1;
+  state->received = 0;
+
+  list_add(async_list, state);
+  async_schedule();
+
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+void
+coap_async_cancel(struct coap_async_request *state)
+{
+  async_cancel_blocks(state, 0);
+  list_remove(async_list, state);
+}
+/*----------------------------------------------------------------------------*/
+int
+coap_async_receive(coap_packet_t *response, uip_ipaddr_t *addr, uint16_t port)
+{
+  coap_exchange_t *ex;
+  uint8_t ack[COAP_HEADER_LEN];
+
+  for (ex = (coap_exchange_t *) list_head(exchanges_list); ex; ex = ex->next)
+  {
+    if (response->token_len==COAP_ASYNC_TOKEN_LEN && memcmp(ex->token, response->token, COAP_ASYNC_TOKEN_LEN)==0
+        && ex->owner->port==port && uip_ipaddr_cmp(&ex->owner->addr, addr))
+    {
+      break;
+    }
+  }
+  if (ex==NULL)
+  {
+    return 0;
+  }
+
+  PRINTF("Received separate response\n");
+
+  /* The response buffer is reused for sending, so acknowledge after the handler. */
+  ack[0] = 1<<COAP_HEADER_VERSION_POSITION | COAP_TYPE_ACK<<COAP_HEADER_TYPE_POSITION;
+  ack[1] = 0;
+  ack[2] = (uint8_t) (response->mid>>8);
+  ack[3] = (uint8_t) (response->mid);
+
+  if (response->type==COAP_TYPE_CON)
+  {
+    uip_ipaddr_t src;
+
+    uip_ipaddr_copy(&src, addr);
+    exchange_response(ex, response);
+    coap_send_message(&src, port, ack, COAP_HEADER_LEN);
+  }
+  else
+  {
+    exchange_response(ex, response);
+  }
+  async_schedule();
+
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
 /*- Engine Interface ---------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 const struct rest_implementation coap_rest_implementation = {
@@ -93,4 +93,69 @@ PT_THREAD(coap_blocking_request(struct request_state_t *state, process_event_t e
 
 void coap_simple_request(uip_ipaddr_t *addr, uint16_t port, coap_packet_t *request);
 
+/*-----------------------------------------------------------------------------------*/
+/*- Asynchronous client -------------------------------------------------------------*/
+/*-----------------------------------------------------------------------------------*/
+/*
+ * The number of requests that are in flight to the same server at the same time.
+ */
+#ifndef COAP_NSTART
+#define COAP_NSTART                    1
+#endif /* COAP_NSTART */
+
+/*
+ * The number of requests that are in flight to all servers; each one holds a transaction.
+ */
+#ifndef COAP_MAX_OPEN_EXCHANGES
+#define COAP_MAX_OPEN_EXCHANGES        COAP_MAX_OPEN_TRANSACTIONS
+#endif /* COAP_MAX_OPEN_EXCHANGES */
+
+/* Time in seconds to wait for a separate response after an empty ACK. */
+#ifndef COAP_SEPARATE_RESPONSE_TIMEOUT
+#define COAP_SEPARATE_RESPONSE_TIMEOUT 30
+#endif /* COAP_SEPARATE_RESPONSE_TIMEOUT */
+
+#define COAP_ASYNC_TOKEN_LEN           4
+
+typedef enum {
+  COAP_ASYNC_PENDING,
+  COAP_ASYNC_DONE,
+  COAP_ASYNC_FAILED
+} coap_async_status_t;
+
+struct coap_async_request;
+
+/*
+ * Called for every response with status COAP_ASYNC_PENDING, and with COAP_ASYNC_DONE for the
+ * response that completes the request. Blocks of a block-wise transfer may arrive out of order;
+ * their Block2 option gives the offset. On timeouts and errors, the handler is called once with
+ * a NULL response and COAP_ASYNC_FAILED.
+ */
+typedef void (*coap_async_handler)(struct coap_async_request *state, void *response);
+
+struct coap_async_request {
+  struct coap_async_request *next; /* for LIST */
+
+  uip_ipaddr_t addr;
+  uint16_t port;
+  coap_packet_t *request; /* must stay valid until the request is completed */
+  coap_async_handler handler;
+  void *data;
+  coap_async_status_t status;
+
+  uint8_t in_flight;
+  uint8_t blockwise;
+  uint8_t last_known;
+  uint16_t block_size;
+  uint32_t next_block; /* next block to request */
+  uint32_t end_block; /* number of blocks, or an upper bound while the last block is not known */
+  uint32_t min_blocks; /* number of blocks that are known to exist */
+  uint32_t received;
+};
+
+int coap_async_request(struct coap_async_request *state, uip_ipaddr_t *addr, uint16_t port,
+                       coap_packet_t *request, coap_async_handler handler, void *data);
+void coap_async_cancel(struct coap_async_request *state);
+int coap_async_receive(coap_packet_t *response, uip_ipaddr_t *addr, uint16_t port);
+
 #endif /* COAP_SERVER_H_ */
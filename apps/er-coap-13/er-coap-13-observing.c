@@ -56,6 +56,47 @@
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
 
+/* Observers indexed by resource URL, so that notifications only visit the observers of their resource. */
+static coap_observer_t *observers_index[COAP_OBSERVING_HASH_SIZE];
+
+/* Notification that is being sent to the observers of a resource, serialized without Token. */
+static struct {
+  const char *url;
+  coap_observer_t *next; /* next observer to notify */
+  uint8_t type;
+  uint16_t len;
+  uint8_t buffer[COAP_MAX_PACKET_SIZE];
+} pending;
+
+#if COAP_OBSERVING_PACING_INTERVAL
+static struct ctimer pacing_timer;
+#endif
+
+/*-----------------------------------------------------------------------------------*/
+static
+coap_observer_t **
+observer_bucket(const char *url)
+{
+  uint8_t hash = 0;
+
+  while (*url)
+  {
+    hash = hash * 31 + *url++;
+  }
+  return &observers_index[hash % COAP_OBSERVING_HASH_SIZE];
+}
+/*-----------------------------------------------------------------------------------*/
+static
+coap_observer_t *
+next_observer(coap_observer_t *obs, const char *url)
+{
+  while (obs && obs->url!=url) /* using RESOURCE url pointer as handle */
+  {
+    obs = obs->resource_next;
+  }
+  return obs;
+}
+/*-----------------------------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
 coap_observer_t *
 coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_t token_len, const char *url)
@@ -64,6 +105,7 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_
   coap_remove_observer_by_url(addr, port, url);
 
   coap_observer_t *o = memb_alloc(&observers_memb);
+  coap_observer_t **link;
 
   if (o)
   {
@@ -78,6 +120,11 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_
 
     PRINTF("Adding observer for /%s [0x%02X%02X]\n", o->url, o->token[0], o->token[1]);
     list_add(observers_list, o);
+
+    /* append to notify in the order of registration */
+    o->resource_next = NULL;
+    for (link = observer_bucket(url); *link; link = &(*link)->resource_next);
+    *link = o;
   }
 
   return o;
@@ -86,10 +133,25 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_
 void
 coap_remove_observer(coap_observer_t *o)
 {
+  coap_observer_t **link;
+
   PRINTF("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0], o->token[1]);
 
-  memb_free(&observers_memb, o);
+  if (o==pending.next)
+  {
+    pending.next = next_observer(o->resource_next, pending.url);
+  }
+  for (link = observer_bucket(o->url); *link; link = &(*link)->resource_next)
+  {
+    if (*link==o)
+    {
+      *link = o->resource_next;
+      break;
+    }
+  }
+
   list_remove(observers_list, o);
+  memb_free(&observers_memb, o);
 }
 
 int
@@ -166,56 +228,129 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
   return removed;
 }
 /*-----------------------------------------------------------------------------------*/
+static
+uint16_t
+build_notification(uint8_t *buffer, coap_observer_t *obs, uint8_t type, uint16_t mid)
+{
+  /* Patch type, Token length, and MID into the header and insert the Token before the options. */
+  buffer[0] = (pending.buffer[0] & ~(COAP_HEADER_TYPE_MASK | COAP_HEADER_TOKEN_LEN_MASK))
+            | (COAP_HEADER_TYPE_MASK & type<<COAP_HEADER_TYPE_POSITION)
+            | (COAP_HEADER_TOKEN_LEN_MASK & obs->token_len<<COAP_HEADER_TOKEN_LEN_POSITION);
+  buffer[1] = pending.buffer[1];
+  buffer[2] = (uint8_t) (mid>>8);
+  buffer[3] = (uint8_t) (mid);
+  memcpy(buffer + COAP_HEADER_LEN, obs->token, obs->token_len);
+  memcpy(buffer + COAP_HEADER_LEN + obs->token_len, pending.buffer + COAP_HEADER_LEN, pending.len - COAP_HEADER_LEN);
+
+  return pending.len + obs->token_len;
+}
+/*-----------------------------------------------------------------------------------*/
+static
+void
+notify_next_observer(void)
+{
+  coap_observer_t *obs = pending.next;
+  coap_transaction_t *transaction = NULL;
+
+  pending.next = next_observer(obs->resource_next, pending.url);
+
+  PRINTF("           Observer ");
+  PRINT6ADDR(&obs->addr);
+  PRINTF(":%u\n", obs->port);
+
+  if (pending.len + obs->token_len > COAP_MAX_PACKET_SIZE)
+  {
+    PRINTF("           Token does not fit\n");
+    return;
+  }
+
+  /* Use CON to check whether client is still there/interested after COAP_OBSERVING_REFRESH_INTERVAL. */
+  if (pending.type==COAP_TYPE_CON || stimer_expired(&obs->refresh_timer))
+  {
+    if ( (transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port)) )
+    {
+      if (pending.type!=COAP_TYPE_CON)
+      {
+        PRINTF("           Refreshing with CON\n");
+        stimer_restart(&obs->refresh_timer);
+      }
+
+      /* Update last MID for RST matching. */
+      obs->last_mid = transaction->mid;
+
+      transaction->packet_len = build_notification(transaction->packet, obs, COAP_TYPE_CON, transaction->mid);
+      coap_send_transaction(transaction);
+    }
+  }
+  else
+  {
+    /* Not retransmitted, so the notification is built in place in the uIP buffer. */
+    obs->last_mid = coap_get_mid();
+    coap_send_message(&obs->addr, obs->port, COAP_SEND_BUF, build_notification(COAP_SEND_BUF, obs, pending.type, obs->last_mid));
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+#if COAP_OBSERVING_PACING_INTERVAL
+static
+void
+pacing_callback(void *ptr)
+{
+  if (pending.next)
+  {
+    notify_next_observer();
+  }
+  if (pending.next)
+  {
+    ctimer_set(&pacing_timer, COAP_OBSERVING_PACING_INTERVAL, pacing_callback, NULL);
+  }
+}
+#endif
+/*-----------------------------------------------------------------------------------*/
 void
 coap_notify_observers(resource_t *resource, int32_t obs_counter, void *notification)
 {
   coap_packet_t *const coap_res = (coap_packet_t *) notification;
-  coap_observer_t* obs = NULL;
-  uint8_t preferred_type = coap_res->type;
+  coap_observer_t *first = next_observer(*observer_bucket(resource->url), resource->url);
 
   PRINTF("Observing: Notification from %s\n", resource->url);
 
-  /* Iterate over observers. */
-  for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
+  if (first==NULL)
   {
-    if (obs->url==resource->url) /* using RESOURCE url pointer as handle */
+    return;
+  }
+
+  /* A fan-out in progress for another resource is completed first, one for the same resource is superseded. */
+  if (pending.url!=resource->url)
+  {
+    while (pending.next)
     {
-      coap_transaction_t *transaction = NULL;
+      notify_next_observer();
+    }
+  }
 
-      /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers. */
+  /* Serialize once, the Token and MID are patched in for each observer. */
+  coap_res->mid = 0;
+  coap_res->token_len = 0;
+  if (obs_counter>=0) coap_set_header_observe(coap_res, obs_counter);
 
-      if ( (transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port)) )
-      {
-        PRINTF("           Observer ");
-        PRINT6ADDR(&obs->addr);
-        PRINTF(":%u\n", obs->port);
-
-        /* Update last MID for RST matching. */
-        obs->last_mid = transaction->mid;
-
-        /* Prepare response */
-        coap_res->mid = transaction->mid;
-        if (obs_counter>=0) coap_set_header_observe(coap_res, obs_counter);
-        coap_set_header_token(coap_res, obs->token, obs->token_len);
-
-        /* Use CON to check whether client is still there/interested after COAP_OBSERVING_REFRESH_INTERVAL. */
-        if (stimer_expired(&obs->refresh_timer))
-        {
-          PRINTF("           Refreshing with CON\n");
-          coap_res->type = COAP_TYPE_CON;
-          stimer_restart(&obs->refresh_timer);
-        }
-        else
-        {
-          coap_res->type = preferred_type;
-        }
-
-        transaction->packet_len = coap_serialize_message(coap_res, transaction->packet);
-
-        coap_send_transaction(transaction);
-      }
-    }
+  if ((pending.len = coap_serialize_message(coap_res, pending.buffer))==0)
+  {
+    PRINTF("           Serialization failed\n");
+    pending.next = NULL;
+    return;
   }
+  pending.url = resource->url;
+  pending.type = coap_res->type;
+  pending.next = first;
+
+#if COAP_OBSERVING_PACING_INTERVAL
+  pacing_callback(NULL);
+#else
+  while (pending.next)
+  {
+    notify_next_observer();
+  }
+#endif
 }
 /*-----------------------------------------------------------------------------------*/
 void
@@ -50,12 +50,23 @@
 /* Interval in seconds in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVING_REFRESH_INTERVAL  60
 
+/* Number of hash buckets that index the observers by resource URL. */
+#ifndef COAP_OBSERVING_HASH_SIZE
+#define COAP_OBSERVING_HASH_SIZE         4
+#endif /* COAP_OBSERVING_HASH_SIZE */
+
+/* Clock ticks between the notifications of a fan-out to avoid overrunning the MAC queue; 0 sends them all at once. */
+#ifndef COAP_OBSERVING_PACING_INTERVAL
+#define COAP_OBSERVING_PACING_INTERVAL   0
+#endif /* COAP_OBSERVING_PACING_INTERVAL */
+
 #if COAP_MAX_OPEN_TRANSACTIONS<COAP_MAX_OBSERVERS
 #warning "COAP_MAX_OPEN_TRANSACTIONS smaller than COAP_MAX_OBSERVERS: cannot handle CON notifications"
 #endif
 
 typedef struct coap_observer {
   struct coap_observer *next; /* for LIST */
+  struct coap_observer *resource_next; /* for the resource index */
 
   const char *url;
   uip_ipaddr_t addr;
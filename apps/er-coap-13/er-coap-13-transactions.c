@@ -63,7 +63,16 @@
 
 
 MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
-LIST(transactions_list);
+static coap_transaction_t *transactions_hash[COAP_TRANSACTION_HASH_SIZE];
+
+#define TRANSACTION_BUCKET(mid) ((mid) & (COAP_TRANSACTION_HASH_SIZE - 1))
+
+/* Timer wheel for CON retransmissions. wheel_slot was last processed at wheel_time. */
+static coap_transaction_t *wheel[COAP_TRANSACTION_WHEEL_SIZE];
+static uint8_t wheel_slot;
+static clock_time_t wheel_time;
+static uint16_t wheel_scheduled;
+static struct etimer wheel_timer;
 
 
 static struct process *transaction_handler_process = NULL;
@@ -74,10 +83,90 @@ coap_register_as_transaction_handler()
   transaction_handler_process = PROCESS_CURRENT();
 }
 
+/*----------------------------------------------------------------------------*/
+static void
+wheel_set_timer(uint8_t ticks)
+{
+  clock_time_t elapsed = clock_time() - wheel_time;
+  clock_time_t delay = (clock_time_t)ticks * COAP_TRANSACTION_WHEEL_TICK;
+
+  /*FIXME
+   * Hack: Setting timer for responsible process.
+   * Maybe there is a better way, but avoid posting everything to the process.
+   */
+  struct process *process_actual = PROCESS_CURRENT();
+  process_current = transaction_handler_process;
+  etimer_set(&wheel_timer, delay > elapsed ? delay - elapsed : 1);
+  process_current = process_actual;
+}
+
+static void
+wheel_insert(coap_transaction_t **slot, coap_transaction_t *t)
+{
+  t->wheel_next = *slot;
+  t->wheel_prev = slot;
+  if (*slot)
+  {
+    (*slot)->wheel_prev = &t->wheel_next;
+  }
+  *slot = t;
+}
+
+static void
+wheel_remove(coap_transaction_t *t)
+{
+  if (t->wheel_prev)
+  {
+    *t->wheel_prev = t->wheel_next;
+    if (t->wheel_next)
+    {
+      t->wheel_next->wheel_prev = t->wheel_prev;
+    }
+    t->wheel_prev = NULL;
+    --wheel_scheduled;
+  }
+}
+
+static void
+wheel_add(coap_transaction_t *t)
+{
+  clock_time_t elapsed;
+  clock_time_t ticks;
+  uint8_t first;
+
+  wheel_remove(t);
+
+  elapsed = clock_time() - wheel_time;
+  if (wheel_scheduled==0 && etimer_expired(&wheel_timer))
+  {
+    /* The wheel was idle and all its slots are empty, so just move it forward. */
+    wheel_slot = (wheel_slot + elapsed / COAP_TRANSACTION_WHEEL_TICK) % COAP_TRANSACTION_WHEEL_SIZE;
+    wheel_time += elapsed - elapsed % COAP_TRANSACTION_WHEEL_TICK;
+    elapsed %= COAP_TRANSACTION_WHEEL_TICK;
+  }
+
+  /* Round up so that the slot is never processed before the timer expired. */
+  ticks = (elapsed + t->retrans_timer.interval + COAP_TRANSACTION_WHEEL_TICK - 1) / COAP_TRANSACTION_WHEEL_TICK;
+  first = (ticks - 1) % COAP_TRANSACTION_WHEEL_SIZE + 1;
+
+  wheel_insert(&wheel[(wheel_slot + ticks) % COAP_TRANSACTION_WHEEL_SIZE], t);
+
+  /* A pending timer event reschedules itself in coap_check_transactions(). */
+  if (++wheel_scheduled==1 || !etimer_expired(&wheel_timer))
+  {
+    if (etimer_expired(&wheel_timer)
+        || etimer_expiration_time(&wheel_timer) - wheel_time > (clock_time_t)first * COAP_TRANSACTION_WHEEL_TICK)
+    {
+      wheel_set_timer(first);
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
 coap_transaction_t *
 coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
 {
   coap_transaction_t *t = memb_alloc(&transactions_memb);
+  coap_transaction_t **slot;
 
   if (t)
   {
@@ -88,7 +177,12 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
     uip_ipaddr_copy(&t->addr, addr);
     t->port = port;
 
-    list_add(transactions_list, t); /* List itself makes sure same element is not added twice. */
+    t->wheel_prev = NULL;
+
+    /* append to keep the oldest transaction first for duplicate MIDs */
+    t->next = NULL;
+    for (slot = &transactions_hash[TRANSACTION_BUCKET(mid)]; *slot; slot = &(*slot)->next);
+    *slot = t;
   }
 
   return t;
@@ -110,23 +204,17 @@ coap_send_transaction(coap_transaction_t *t)
 
       if (t->retrans_counter==0)
       {
-        t->retrans_timer.timer.interval = COAP_RESPONSE_TIMEOUT_TICKS + (random_rand() % (clock_time_t) COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
-        PRINTF("Initial interval %f\n", (float)t->retrans_timer.timer.interval/CLOCK_SECOND);
+        t->retrans_timer.interval = COAP_RESPONSE_TIMEOUT_TICKS + (random_rand() % (clock_time_t) COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+        PRINTF("Initial interval %f\n", (float)t->retrans_timer.interval/CLOCK_SECOND);
       }
       else
       {
-        t->retrans_timer.timer.interval <<= 1; /* double */
-        PRINTF("Doubled (%u) interval %f\n", t->retrans_counter, (float)t->retrans_timer.timer.interval/CLOCK_SECOND);
+        t->retrans_timer.interval <<= 1; /* double */
+        PRINTF("Doubled (%u) interval %f\n", t->retrans_counter, (float)t->retrans_timer.interval/CLOCK_SECOND);
       }
 
-      /*FIXME
-       * Hack: Setting timer for responsible process.
-       * Maybe there is a better way, but avoid posting everything to the process.
-       */
-      struct process *process_actual = PROCESS_CURRENT();
-      process_current = transaction_handler_process;
-      etimer_restart(&t->retrans_timer); /* interval updated above */
-      process_current = process_actual;
+      timer_restart(&t->retrans_timer); /* interval updated above */
+      wheel_add(t);
 
       t = NULL;
     }
@@ -158,10 +246,19 @@ coap_clear_transaction(coap_transaction_t *t)
 {
   if (t)
   {
+    coap_transaction_t **slot;
+
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
-    etimer_stop(&t->retrans_timer);
-    list_remove(transactions_list, t);
+    wheel_remove(t);
+    for (slot = &transactions_hash[TRANSACTION_BUCKET(t->mid)]; *slot; slot = &(*slot)->next)
+    {
+      if (*slot==t)
+      {
+        *slot = t->next;
+        break;
+      }
+    }
     memb_free(&transactions_memb, t);
   }
 }
@@ -171,7 +268,7 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
-  for (t = (coap_transaction_t*)list_head(transactions_list); t; t = t->next)
+  for (t = transactions_hash[TRANSACTION_BUCKET(mid)]; t; t = t->next)
   {
     if (t->mid==mid)
     {
@@ -185,15 +282,49 @@ coap_get_transaction_by_mid(uint16_t mid)
 void
 coap_check_transactions()
 {
-  coap_transaction_t *t = NULL;
+  coap_transaction_t *pending;
+  coap_transaction_t *t;
+  uint8_t ticks;
+
+  if (!etimer_expired(&wheel_timer))
+  {
+    return;
+  }
 
-  for (t = (coap_transaction_t*)list_head(transactions_list); t; t = t->next)
+  while ((clock_time_t)(clock_time() - wheel_time) >= COAP_TRANSACTION_WHEEL_TICK)
   {
-    if (etimer_expired(&t->retrans_timer))
+    wheel_time += COAP_TRANSACTION_WHEEL_TICK;
+    wheel_slot = (wheel_slot + 1) % COAP_TRANSACTION_WHEEL_SIZE;
+
+    /* Detach the slot, as retransmissions and callbacks may schedule and clear transactions. */
+    pending = wheel[wheel_slot];
+    wheel[wheel_slot] = NULL;
+    if (pending)
     {
-      ++(t->retrans_counter);
-      PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
-      coap_send_transaction(t);
+      pending->wheel_prev = &pending;
     }
+
+    while ((t = pending))
+    {
+      wheel_remove(t);
+      if (timer_expired(&t->retrans_timer))
+      {
+        ++(t->retrans_counter);
+        PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+        coap_send_transaction(t);
+      }
+      else
+      {
+        /* due in a later revolution */
+        wheel_insert(&wheel[wheel_slot], t);
+        ++wheel_scheduled;
+      }
+    }
+  }
+
+  if (wheel_scheduled && etimer_expired(&wheel_timer))
+  {
+    for (ticks = 1; wheel[(wheel_slot + ticks) % COAP_TRANSACTION_WHEEL_SIZE]==NULL; ++ticks);
+    wheel_set_timer(ticks);
   }
 }
@@ -48,14 +48,38 @@
 #define COAP_MAX_OPEN_TRANSACTIONS 4 
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/*
+ * CON retransmissions are scheduled on a timer wheel driven by a single etimer. It has
+ * COAP_TRANSACTION_WHEEL_SIZE slots of COAP_TRANSACTION_WHEEL_TICK clock ticks each; longer
+ * intervals stay in their slot for several revolutions. Retransmissions may be late by up to one tick.
+ */
+#ifndef COAP_TRANSACTION_WHEEL_SIZE
+#define COAP_TRANSACTION_WHEEL_SIZE 16
+#endif /* COAP_TRANSACTION_WHEEL_SIZE */
+
+#ifndef COAP_TRANSACTION_WHEEL_TICK
+#define COAP_TRANSACTION_WHEEL_TICK (CLOCK_SECOND / 4)
+#endif /* COAP_TRANSACTION_WHEEL_TICK */
+
+/*
+ * The number of hash buckets for looking up open transactions by MID. Must be a power of two.
+ */
+#ifndef COAP_TRANSACTION_HASH_SIZE
+#define COAP_TRANSACTION_HASH_SIZE 8
+#endif /* COAP_TRANSACTION_HASH_SIZE */
+
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
-  struct coap_transaction *next; /* for LIST */
+  struct coap_transaction *next; /* for the MID hash bucket */
 
   uint16_t mid;
-  struct etimer retrans_timer;
+  struct timer retrans_timer;
   uint8_t retrans_counter;
 
+  /* timer wheel slot links, wheel_prev is NULL while not scheduled */
+  struct coap_transaction *wheel_next;
+  struct coap_transaction **wheel_prev;
+
   uip_ipaddr_t addr;
   uint16_t port;
 
@@ -92,8 +92,18 @@
 #define COAP_MAX_ATTEMPTS             4
 #endif /* COAP_MAX_ATTEMPTS */
 
+/*
+ * Serialize responses that are not retransmitted directly into the outgoing uIP buffer instead of the
+ * transaction buffer, which saves copying the message twice. The request is overwritten while serializing,
+ * so resource handlers must not point response options to strings of the request in this mode.
+ */
+#ifndef COAP_ZERO_COPY
+#define COAP_ZERO_COPY                0
+#endif /* COAP_ZERO_COPY */
+
 #define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_UDP_BUF   ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+#define COAP_SEND_BUF ((uint8_t *)&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN])
 
 /* Bitmap for set options */
 enum { OPTION_MAP_SIZE = sizeof(uint8_t) * 8 };
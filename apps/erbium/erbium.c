@@ -58,6 +58,158 @@ PROCESS_NAME(rest_manager_process);
 LIST(restful_services);
 LIST(restful_periodic_services);
 
+#if REST_RESOURCE_INDEX_SIZE
+/*
+ * The index holds the activated resources sorted by URL. The activation order is kept so
+ * that a request that matches several resources is dispatched like through the list.
+ */
+struct resource_index_entry {
+  resource_t* resource;
+  uint16_t order;
+};
+
+static struct resource_index_entry resource_index[REST_RESOURCE_INDEX_SIZE];
+static uint16_t resource_index_count;
+static uint16_t resource_index_order;
+static uint8_t resource_index_overflow;
+
+/* Compares a resource URL with the first len characters of a request URL. */
+static int
+url_compare(const char *resource_url, const char *url, int len)
+{
+  int result = strncmp(resource_url, url, len);
+
+  if (result == 0 && resource_url[len] != '\0')
+  {
+    return 1;
+  }
+  return result;
+}
+
+/* Returns the position of the first resource whose URL is not less than the first len
+ * characters of url. */
+static uint16_t
+resource_index_search(const char *url, int len)
+{
+  uint16_t low = 0;
+  uint16_t high = resource_index_count;
+  uint16_t middle;
+
+  while (low < high)
+  {
+    middle = low + (high - low) / 2;
+    if (url_compare(resource_index[middle].resource->url, url, len) < 0)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/* Returns the position after the resources whose URL is the first len characters of url,
+ * starting from position i. */
+static uint16_t
+resource_index_skip(uint16_t i, const char *url, int len)
+{
+  while (i < resource_index_count && url_compare(resource_index[i].resource->url, url, len) == 0)
+  {
+    ++i;
+  }
+  return i;
+}
+
+static void
+resource_index_add(resource_t* resource)
+{
+  int len = strlen(resource->url);
+  uint16_t i;
+  uint16_t end;
+
+  if (resource_index_overflow)
+  {
+    return;
+  }
+
+  /* A resource that is activated again moves to the end of the list. */
+  end = resource_index_skip(resource_index_search(resource->url, len), resource->url, len);
+  for (i = resource_index_search(resource->url, len); i < end; ++i)
+  {
+    if (resource_index[i].resource == resource)
+    {
+      --resource_index_count;
+      memmove(&resource_index[i], &resource_index[i + 1],
+              (resource_index_count - i) * sizeof(resource_index[0]));
+      break;
+    }
+  }
+
+  if (resource_index_count == REST_RESOURCE_INDEX_SIZE)
+  {
+    PRINTF("Resource index full, dispatching through the resource list\n");
+    resource_index_overflow = 1;
+    return;
+  }
+
+  /* Insert the resource after the ones with the same URL. */
+  i = resource_index_skip(resource_index_search(resource->url, len), resource->url, len);
+  memmove(&resource_index[i + 1], &resource_index[i],
+          (resource_index_count - i) * sizeof(resource_index[0]));
+  resource_index[i].resource = resource;
+  resource_index[i].order = resource_index_order++;
+  ++resource_index_count;
+}
+
+/*
+ * Finds the first activated resource that matches the URL exactly or, if it has
+ * sub-resources, is a prefix of it. Only a few binary searches are needed: all URLs sorted
+ * between a prefix of the URL and the URL itself start with that prefix, so the longest
+ * common prefix of the URL and the entry before a search position bounds the length of the
+ * prefixes that remain to be found.
+ */
+static resource_t*
+resource_index_find(const char *url, int url_len)
+{
+  struct resource_index_entry *entry;
+  struct resource_index_entry *best = NULL;
+  struct resource_index_entry *end;
+  uint16_t pos;
+  int len = url_len;
+  const char *before;
+
+  pos = resource_index_search(url, len);
+  for (;;)
+  {
+    end = &resource_index[resource_index_skip(pos, url, len)];
+    for (entry = &resource_index[pos]; entry < end; ++entry)
+    {
+      if (len == url_len || (entry->resource->flags & HAS_SUB_RESOURCES))
+      {
+        if (best == NULL || entry->order < best->order)
+        {
+          best = entry;
+        }
+        break;
+      }
+    }
+
+    if (pos == 0 || len == 0)
+    {
+      break;
+    }
+
+    before = resource_index[pos - 1].resource->url;
+    for (len = 0; len < url_len && before[len] == url[len]; ++len);
+    pos = resource_index_search(url, len);
+  }
+
+  return best ? best->resource : NULL;
+}
+#endif /* REST_RESOURCE_INDEX_SIZE */
+
 
 void
 rest_init_engine(void)
@@ -88,6 +240,9 @@ rest_activate_resource(resource_t* resource)
   }
 
   list_add(restful_services, resource);
+#if REST_RESOURCE_INDEX_SIZE
+  resource_index_add(resource);
+#endif
 }
 
 void
@@ -149,42 +304,55 @@ rest_invoke_restful_service(void* request, void* response, uint8_t *buffer, uint
   uint8_t found = 0;
   uint8_t allowed = 0;
 
-  PRINTF("rest_invoke_restful_service url /%.*s -->\n", url_len, url);
-
   resource_t* resource = NULL;
   const char *url = NULL;
+  int url_len = REST.get_url(request, &url);
+
+  PRINTF("rest_invoke_restful_service url /%.*s -->\n", url_len, url);
 
+#if REST_RESOURCE_INDEX_SIZE
+  if (!resource_index_overflow)
+  {
+    resource = resource_index_find(url, url_len);
+  }
+  else
+#endif
   for (resource = (resource_t*)list_head(restful_services); resource; resource = resource->next)
   {
     /*if the web service handles that kind of requests and urls matches*/
-    if ((REST.get_url(request, &url)==strlen(resource->url) || (REST.get_url(request, &url)>strlen(resource->url) && (resource->flags & HAS_SUB_RESOURCES)))
+    if ((url_len==strlen(resource->url)
+         || (url_len>strlen(resource->url) && (resource->flags & HAS_SUB_RESOURCES)))
         && strncmp(resource->url, url, strlen(resource->url)) == 0)
     {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
+      break;
+    }
+  }
 
-      PRINTF("method %u, resource->flags %u\n", (uint16_t)method, resource->flags);
+  if (resource)
+  {
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
 
-      if (resource->flags & method)
+    PRINTF("method %u, resource->flags %u\n", (uint16_t)method, resource->flags);
+
+    if (resource->flags & method)
+    {
+      allowed = 1;
+
+      /*call pre handler if it exists*/
+      if (!resource->pre_handler || resource->pre_handler(resource, request, response))
       {
-        allowed = 1;
+        /* call handler function*/
+        resource->handler(request, response, buffer, buffer_size, offset);
 
-        /*call pre handler if it exists*/
-        if (!resource->pre_handler || resource->pre_handler(resource, request, response))
+        /*call post handler if it exists*/
+        if (resource->post_handler)
         {
-          /* call handler function*/
-          resource->handler(request, response, buffer, buffer_size, offset);
-
-          /*call post handler if it exists*/
-          if (resource->post_handler)
-          {
-            resource->post_handler(resource, request, response);
-          }
+          resource->post_handler(resource, request, response);
         }
-      } else {
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
       }
-      break;
+    } else {
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
 
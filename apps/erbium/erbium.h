@@ -53,6 +53,15 @@
 #define REST_MAX_CHUNK_SIZE     64
 #endif
 
+/*
+ * The number of resources that are looked up through an index sorted by URL instead of a linear search.
+ * Servers with many resources should set it to at least the number of activated resources; if more are
+ * activated, requests are dispatched through the resource list. Set to 0 to save the RAM of the index.
+ */
+#ifndef REST_RESOURCE_INDEX_SIZE
+#define REST_RESOURCE_INDEX_SIZE 0
+#endif
+
 #ifndef MIN
 #define MIN(a, b) ((a) < (b)? (a) : (b))
 #endif /* MIN */
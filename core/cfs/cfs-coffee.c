@@ -90,6 +90,54 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING	1
 #endif
 
+/*
+ * An index in RAM from hashes of file names to the first pages of
+ * the files spares file lookups from scanning the file headers in the
+ * storage. The index is built during the first lookup that does not
+ * find the file among the cached files. The value is the amount of
+ * files that can be indexed; lookups of files that do not fit in the
+ * index fall back to scanning. Set to 0 to disable the index.
+ */
+#ifndef COFFEE_NAME_INDEX_SIZE
+#define COFFEE_NAME_INDEX_SIZE	0
+#endif
+
+/*
+ * Reclaim full sectors of obsolete pages in a background process
+ * instead of in the context of the function that removed a file. The
+ * process erases one sector at a time, preferring the least worn
+ * sector, and yields to other processes in between. reserve() still
+ * collects garbage synchronously if it runs out of space before the
+ * process has caught up. The erase count of each sector is kept in a
+ * log in the last sector of the storage, which is therefore not
+ * available for files; the storage must be formatted after enabling
+ * this option. The log sector must hold more records than there are
+ * sectors, which rules out layouts with many small sectors.
+ */
+#ifndef COFFEE_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC	0
+#endif
+
+/*
+ * The background collector leaves a sector of obsolete pages alone if
+ * it has been erased COFFEE_GC_WEAR_SLACK times more than the least
+ * worn sector, so that new files go to less worn sectors instead. Such
+ * sectors are still erased when fewer than COFFEE_GC_MIN_FREE pages
+ * are free, or by reserve() when it runs out of space.
+ */
+#ifndef COFFEE_GC_WEAR_SLACK
+#define COFFEE_GC_WEAR_SLACK	8
+#endif
+
+#ifndef COFFEE_GC_MIN_FREE
+#define COFFEE_GC_MIN_FREE	(2 * COFFEE_PAGES_PER_SECTOR)
+#endif
+
+#if COFFEE_BACKGROUND_GC
+#include "sys/process.h"
+#include "lib/assert.h"
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -134,6 +182,17 @@
 #define HDR_FLAG_LOG		0x10	/* Log file. */
 #define HDR_FLAG_ISOLATED	0x20	/* Isolated page. */
 
+/*
+ * The EOF hint in the file header tells file_end() where to start
+ * looking for the end of the file. The reserved pages of a file are
+ * divided into eight segments, and bit N (1-7) is set when the file has
+ * been extended into segment N. Bits are only ever set, so the hint can
+ * be updated without erasing the header. Files created before the hint
+ * was maintained do not have the valid bit set and are scanned fully.
+ */
+#define EOF_HINT_VALID		0x1
+#define EOF_HINT_SEGMENTS	8
+
 /* File header macros. */
 #define CHECK_FLAG(hdr, flag)	((hdr).flags & (flag))
 #define HDR_VALID(hdr)		CHECK_FLAG(hdr, HDR_FLAG_VALID)
@@ -148,9 +207,17 @@
 				!HDR_ISOLATED(hdr))
 
 /* Shortcuts derived from the hardware-dependent configuration of Coffee. */
+#if COFFEE_BACKGROUND_GC
+/* The last sector is reserved for the wear log. */
+#define COFFEE_SECTOR_COUNT	((unsigned)(COFFEE_SIZE / COFFEE_SECTOR_SIZE) - 1)
+#define COFFEE_PAGE_COUNT	\
+	((coffee_page_t)(COFFEE_SECTOR_COUNT * COFFEE_PAGES_PER_SECTOR))
+#define WEAR_LOG_SECTOR		COFFEE_SECTOR_COUNT
+#else
 #define COFFEE_SECTOR_COUNT	(unsigned)(COFFEE_SIZE / COFFEE_SECTOR_SIZE)
 #define COFFEE_PAGE_COUNT	\
 	((coffee_page_t)(COFFEE_SIZE / COFFEE_PAGE_SIZE))
+#endif
 #define COFFEE_PAGES_PER_SECTOR	\
 	((coffee_page_t)(COFFEE_SECTOR_SIZE / COFFEE_PAGE_SIZE))
 
@@ -159,6 +226,9 @@ struct sector_status {
   coffee_page_t active;
   coffee_page_t obsolete;
   coffee_page_t free;
+  /* Pages at the start of the sector that belong to a file starting
+     in an earlier sector. */
+  coffee_page_t carried;
 };
 
 /* The structure of cached file objects. */
@@ -169,6 +239,7 @@ struct file {
   int16_t record_count;
   uint8_t references;
   uint8_t flags;
+  uint8_t eof_hint;
 };
 
 /* The file descriptor structure. */
@@ -188,7 +259,7 @@ struct file_header {
   uint16_t log_records;
   uint16_t log_record_size;
   coffee_page_t max_pages;
-  uint8_t deprecated_eof_hint;
+  uint8_t eof_hint;
   uint8_t flags;
   char name[COFFEE_NAME_LENGTH];
 };
@@ -217,6 +288,69 @@ static struct file_desc * const coffee_fd_set = protected_mem.coffee_fd_set;
 static coffee_page_t * const next_free = &protected_mem.next_free;
 static char * const gc_wait = &protected_mem.gc_wait;
 
+#if COFFEE_BACKGROUND_GC
+/*
+ * The wear log is a sequence of records that each hold the erase count
+ * of a sector. The last record of a sector is its current count. When
+ * the log is full, it is erased and starts over with the counts of all
+ * sectors.
+ */
+struct wear_record {
+  uint16_t sector;
+  uint16_t count;
+  uint16_t check;
+};
+#define WEAR_RECORD_CHECK(rec)	((uint16_t)((rec).sector ^ (rec).count ^ 0xc0ff))
+#define WEAR_LOG_RECORDS	\
+	((unsigned)(COFFEE_SECTOR_SIZE / sizeof(struct wear_record)))
+
+/* A reset log holds one record per sector and must leave room for
+   more, or every erasure would reset it again. Layouts with many small
+   sectors, such as those of the AVR platforms, cannot use the wear
+   log. */
+CTASSERT(COFFEE_SECTOR_COUNT + 1 < WEAR_LOG_RECORDS);
+
+/* The number of times each sector, including the wear log, has been
+   erased. */
+static uint16_t sector_erases[COFFEE_SECTOR_COUNT + 1];
+static char wear_log_loaded;
+static unsigned wear_log_next;
+
+/* The sectors that only held obsolete pages when they were last
+   scanned, with the number of pages to isolate after each of them.
+   Other sectors are INVALID_PAGE. */
+static coffee_page_t gc_isolation[COFFEE_SECTOR_COUNT];
+/* The pages carried over into each sector from a file that starts in
+   an earlier sector. A sector that is carried over completely has no
+   file header of its own and is erased together with the sector before
+   it. */
+static coffee_page_t gc_carried[COFFEE_SECTOR_COUNT];
+static unsigned gc_free_pages;
+/* Incremented on every erasure, so that the GC process notices the
+   erasures made by reserve() and cfs_coffee_format(). */
+static uint16_t erase_generation;
+static uint16_t gc_generation;
+static char gc_rescan;
+
+PROCESS(coffee_gc_process, "Coffee GC");
+#endif /* COFFEE_BACKGROUND_GC */
+
+#if COFFEE_NAME_INDEX_SIZE > 0
+/* An entry of the name index. Unused entries have the page value
+   INVALID_PAGE. */
+struct name_index_entry {
+  coffee_page_t page;
+  uint8_t hash;
+};
+
+#define NAME_INDEX_EMPTY	0 /* Not built yet. */
+#define NAME_INDEX_PARTIAL	1 /* Some files did not fit in the index. */
+#define NAME_INDEX_COMPLETE	2 /* All files are in the index. */
+
+static struct name_index_entry name_index[COFFEE_NAME_INDEX_SIZE];
+static uint8_t name_index_state;
+#endif /* COFFEE_NAME_INDEX_SIZE > 0 */
+
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
@@ -264,6 +398,8 @@ get_sector_status(uint16_t sector, struct sector_status *stats)
     skip_pages = 0;
     last_pages_are_active = 0;
   }
+  stats->carried = skip_pages < COFFEE_PAGES_PER_SECTOR ?
+                   skip_pages : COFFEE_PAGES_PER_SECTOR;
 
   sector_start = sector * COFFEE_PAGES_PER_SECTOR;
   sector_end = sector_start + COFFEE_PAGES_PER_SECTOR;
@@ -362,12 +498,126 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
 
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+static void
+wear_log_write(uint16_t sector)
+{
+  struct wear_record rec;
+
+  rec.sector = sector;
+  rec.count = sector_erases[sector];
+  rec.check = WEAR_RECORD_CHECK(rec);
+  COFFEE_WRITE(&rec, sizeof(rec), WEAR_LOG_SECTOR * COFFEE_SECTOR_SIZE +
+               (unsigned long)wear_log_next * sizeof(rec));
+  wear_log_next++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wear_log_reset(void)
+{
+  uint16_t sector;
+
+  COFFEE_ERASE(WEAR_LOG_SECTOR);
+  sector_erases[WEAR_LOG_SECTOR]++;
+  wear_log_next = 0;
+
+  for(sector = 0;
+      sector <= WEAR_LOG_SECTOR && wear_log_next < WEAR_LOG_RECORDS;
+      sector++) {
+    if(sector_erases[sector] > 0) {
+      wear_log_write(sector);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+wear_log_read(void)
+{
+  struct wear_record rec[8];
+  unsigned i, j, n;
+
+  if(wear_log_loaded) {
+    return;
+  }
+  wear_log_loaded = 1;
+
+  for(i = 0; i < WEAR_LOG_RECORDS; i += n) {
+    n = WEAR_LOG_RECORDS - i;
+    if(n > sizeof(rec) / sizeof(rec[0])) {
+      n = sizeof(rec) / sizeof(rec[0]);
+    }
+    COFFEE_READ(rec, n * sizeof(rec[0]), WEAR_LOG_SECTOR * COFFEE_SECTOR_SIZE +
+                (unsigned long)i * sizeof(rec[0]));
+
+    for(j = 0; j < n; j++) {
+      if(rec[j].sector == 0 && rec[j].count == 0 && rec[j].check == 0) {
+        wear_log_next = i + j;
+        return;
+      }
+      if(rec[j].sector > WEAR_LOG_SECTOR ||
+         rec[j].check != WEAR_RECORD_CHECK(rec[j])) {
+        /* The sector does not hold a wear log. Start a new log on the
+           next erasure. */
+        PRINTF("Coffee: No wear log found\n");
+        memset(sector_erases, 0, sizeof(sector_erases));
+        wear_log_next = WEAR_LOG_RECORDS;
+        return;
+      }
+      if(rec[j].count > sector_erases[rec[j].sector]) {
+        sector_erases[rec[j].sector] = rec[j].count;
+      }
+    }
+  }
+
+  /* The log is full. */
+  wear_log_next = WEAR_LOG_RECORDS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+count_erase(uint16_t sector)
+{
+  wear_log_read();
+
+  sector_erases[sector]++;
+  if(wear_log_next < WEAR_LOG_RECORDS) {
+    wear_log_write(sector);
+  } else {
+    wear_log_reset();
+  }
+  erase_generation++;
+}
+#endif /* COFFEE_BACKGROUND_GC */
+/*---------------------------------------------------------------------------*/
+static void
+erase_sector(uint16_t sector, coffee_page_t carried,
+             coffee_page_t isolation_count)
+{
+  coffee_page_t first_page;
+
+  /* Pages carried over from a file in an earlier sector that is not
+     erased stay covered by its header, so new files start after them. */
+  first_page = sector * COFFEE_PAGES_PER_SECTOR;
+  if(first_page + carried < *next_free) {
+    *next_free = first_page + carried;
+  }
+
+  if(isolation_count > 0) {
+    isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+  }
+
+  COFFEE_ERASE(sector);
+#if COFFEE_BACKGROUND_GC
+  count_erase(sector);
+#endif
+  PRINTF("Coffee: Erased sector %d!\n", sector);
+}
+/*---------------------------------------------------------------------------*/
 static void
 collect_garbage(int mode)
 {
   uint16_t sector;
   struct sector_status stats;
-  coffee_page_t first_page, isolation_count;
+  coffee_page_t isolation_count;
 
   PRINTF("Coffee: Running the file system garbage collector in %s mode\n",
 	 mode == GC_RELUCTANT ? "reluctant" : "greedy");
@@ -387,24 +637,118 @@ collect_garbage(int mode)
 
     if((mode == GC_RELUCTANT && stats.free == 0) ||
        (mode == GC_GREEDY && stats.obsolete > 0)) {
-      first_page = sector * COFFEE_PAGES_PER_SECTOR;
-      if(first_page < *next_free) {
-        *next_free = first_page;
-      }
+      erase_sector(sector, stats.carried, isolation_count);
 
-      if(isolation_count > 0) {
-        isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+      if(mode == GC_RELUCTANT && isolation_count > 0) {
+        break;
       }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+static void
+gc_scan(void)
+{
+  uint16_t sector;
+  struct sector_status stats;
+  coffee_page_t isolation_count;
 
-      COFFEE_ERASE(sector);
-      PRINTF("Coffee: Erased sector %d!\n", sector);
+  /* The sector status has to be computed for all sectors in order. */
+  gc_free_pages = 0;
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    isolation_count = get_sector_status(sector, &stats);
+    gc_free_pages += stats.free;
+    gc_carried[sector] = stats.carried;
+    if(stats.active == 0 && stats.free == 0) {
+      gc_isolation[sector] = isolation_count;
+    } else {
+      gc_isolation[sector] = INVALID_PAGE;
+    }
+  }
 
-      if(mode == GC_RELUCTANT && isolation_count > 0) {
-        break;
+  gc_rescan = 0;
+  gc_generation = erase_generation;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+gc_choose(void)
+{
+  uint16_t sector, best, least_erases;
+
+  best = COFFEE_SECTOR_COUNT;
+  least_erases = sector_erases[0];
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    if(sector_erases[sector] < least_erases) {
+      least_erases = sector_erases[sector];
+    }
+    if(gc_isolation[sector] != INVALID_PAGE &&
+       gc_carried[sector] < COFFEE_PAGES_PER_SECTOR &&
+       (best == COFFEE_SECTOR_COUNT ||
+        sector_erases[sector] < sector_erases[best])) {
+      best = sector;
+    }
+  }
+
+  /* Keep worn sectors out of use while there is enough free space. */
+  if(best < COFFEE_SECTOR_COUNT &&
+     sector_erases[best] >= least_erases + COFFEE_GC_WEAR_SLACK &&
+     gc_free_pages >= COFFEE_GC_MIN_FREE) {
+    return COFFEE_SECTOR_COUNT;
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  static uint16_t sector;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    wear_log_read();
+    gc_scan();
+
+    /* Erase one sector per scheduling round. The sectors are only
+       scanned again if files were removed or sectors were erased by
+       others in between. */
+    while((sector = gc_choose()) < COFFEE_SECTOR_COUNT) {
+      do {
+        erase_sector(sector, gc_carried[sector], gc_isolation[sector]);
+        gc_isolation[sector] = INVALID_PAGE;
+        gc_free_pages += COFFEE_PAGES_PER_SECTOR;
+        sector++;
+      } while(sector < COFFEE_SECTOR_COUNT &&
+              gc_isolation[sector] != INVALID_PAGE &&
+              gc_carried[sector] == COFFEE_PAGES_PER_SECTOR);
+      gc_generation = erase_generation;
+      *gc_wait = 0;
+
+      PROCESS_PAUSE();
+
+      if(gc_rescan || gc_generation != erase_generation) {
+        gc_scan();
       }
     }
   }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_gc(void)
+{
+  gc_rescan = 1;
+  if(process_is_running(&coffee_gc_process)) {
+    process_poll(&coffee_gc_process);
+  } else {
+    process_start(&coffee_gc_process, NULL);
+    process_poll(&coffee_gc_process);
+  }
 }
+#endif /* COFFEE_BACKGROUND_GC */
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
 next_file(coffee_page_t page, struct file_header *hdr)
@@ -459,6 +803,7 @@ load_file(coffee_page_t start, struct file_header *hdr)
   file->page = start;
   file->end = UNKNOWN_OFFSET;
   file->max_pages = hdr->max_pages;
+  file->eof_hint = hdr->eof_hint;
   file->flags = 0;
   if(HDR_MODIFIED(*hdr)) {
     file->flags |= COFFEE_FILE_MODIFIED;
@@ -469,12 +814,121 @@ load_file(coffee_page_t start, struct file_header *hdr)
   return file;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_NAME_INDEX_SIZE > 0
+static uint8_t
+name_hash(const char *name)
+{
+  uint8_t hash;
+  int i;
+
+  /* Only the part of the name that fits in a file header is hashed. */
+  hash = 0;
+  for(i = 0; i < COFFEE_NAME_LENGTH - 1 && name[i] != '\0'; i++) {
+    hash = (hash << 3) + (hash >> 5) + name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_add(const char *name, coffee_page_t page)
+{
+  int i;
+
+  if(name_index_state == NAME_INDEX_EMPTY) {
+    /* The file will be indexed when the index is built. */
+    return;
+  }
+
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    if(name_index[i].page == INVALID_PAGE) {
+      name_index[i].page = page;
+      name_index[i].hash = name_hash(name);
+      return;
+    }
+  }
+  name_index_state = NAME_INDEX_PARTIAL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_remove(coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    if(name_index[i].page == page) {
+      name_index[i].page = INVALID_PAGE;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+  int i;
+
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    name_index[i].page = INVALID_PAGE;
+  }
+  name_index_state = NAME_INDEX_COMPLETE;
+
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      name_index_add(hdr.name, page);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct file *
+name_index_lookup(const char *name)
+{
+  int i, j;
+  uint8_t hash;
+  struct file_header hdr;
+  coffee_page_t page;
+
+  hash = name_hash(name);
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    page = name_index[i].page;
+    if(page == INVALID_PAGE || name_index[i].hash != hash) {
+      continue;
+    }
+
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      for(j = 0; j < COFFEE_MAX_OPEN_FILES; j++) {
+        if(!FILE_FREE(&coffee_files[j]) && coffee_files[j].page == page) {
+          return &coffee_files[j];
+        }
+      }
+      return load_file(page, &hdr);
+    }
+  }
+  return NULL;
+}
+#endif /* COFFEE_NAME_INDEX_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
 static struct file *
 find_file(const char *name)
 {
   int i;
   struct file_header hdr;
   coffee_page_t page;
+
+#if COFFEE_NAME_INDEX_SIZE > 0
+  struct file *file;
+
+  if(name_index_state == NAME_INDEX_EMPTY) {
+    name_index_build();
+  }
+
+  file = name_index_lookup(name);
+  if(file != NULL || name_index_state == NAME_INDEX_COMPLETE) {
+    return file;
+  }
+#endif /* COFFEE_NAME_INDEX_SIZE > 0 */
   
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -499,6 +953,61 @@ find_file(const char *name)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static uint8_t
+eof_hint_bit(coffee_page_t max_pages, cfs_offset_t end)
+{
+  unsigned long page;
+  unsigned segment;
+
+  /* The byte at the end offset is included to be on the safe side. */
+  page = (end + sizeof(struct file_header)) / COFFEE_PAGE_SIZE;
+  if(page >= max_pages) {
+    page = max_pages - 1;
+  }
+  segment = page * EOF_HINT_SEGMENTS / max_pages;
+
+  return segment == 0 ? 0 : 1 << segment;
+}
+/*---------------------------------------------------------------------------*/
+static void
+eof_hint_update(struct file *file, cfs_offset_t end)
+{
+  struct file_header hdr;
+  uint8_t bit;
+
+  bit = eof_hint_bit(file->max_pages, end);
+
+  /* Only the highest segment bit matters, so a lower bit is not set. */
+  if(!(file->eof_hint & EOF_HINT_VALID) || file->eof_hint >= bit) {
+    return;
+  }
+
+  file->eof_hint |= bit;
+  read_header(&hdr, file->page);
+  hdr.eof_hint |= bit;
+  write_header(&hdr, file->page);
+}
+/*---------------------------------------------------------------------------*/
+static coffee_page_t
+eof_hint_last_page(struct file_header *hdr)
+{
+  unsigned segment;
+
+  if(!(hdr->eof_hint & EOF_HINT_VALID)) {
+    return hdr->max_pages - 1;
+  }
+
+  for(segment = EOF_HINT_SEGMENTS - 1; segment > 0; segment--) {
+    if(hdr->eof_hint & (1 << segment)) {
+      break;
+    }
+  }
+
+  /* Return the last page of the segment. */
+  return ((unsigned long)(segment + 1) * hdr->max_pages +
+          EOF_HINT_SEGMENTS - 1) / EOF_HINT_SEGMENTS - 1;
+}
+/*---------------------------------------------------------------------------*/
 static cfs_offset_t
 file_end(coffee_page_t start)
 {
@@ -514,10 +1023,11 @@ file_end(coffee_page_t start)
    * a byte that has been modified.
    *
    * An important implication of this is that if the last written bytes
-   * are zeroes, then these are skipped from the calculation.
+   * are zeroes, then these are skipped from the calculation. The EOF
+   * hint lets us skip the pages beyond the last segment written to.
    */
 
-  for(page = hdr.max_pages - 1; page >= 0; page--) {
+  for(page = eof_hint_last_page(&hdr); page >= 0; page--) {
     COFFEE_READ(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
     for(i = COFFEE_PAGE_SIZE - 1; i >= 0; i--) {
       if(buf[i] != 0) {
@@ -590,6 +1100,10 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
 
+#if COFFEE_NAME_INDEX_SIZE > 0
+  name_index_remove(page);
+#endif
+
   *gc_wait = 0;
 
   /* Close all file descriptors that reference the removed file. */
@@ -609,7 +1123,9 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
     }
   }
 
-#if !COFFEE_EXTENDED_WEAR_LEVELLING
+#if COFFEE_BACKGROUND_GC
+  request_gc();
+#elif !COFFEE_EXTENDED_WEAR_LEVELLING
   if(gc_allowed) {
     collect_garbage(GC_RELUCTANT);
   }
@@ -653,9 +1169,16 @@ reserve(const char *name, coffee_page_t pages,
   memset(&hdr, 0, sizeof(hdr));
   memcpy(hdr.name, name, sizeof(hdr.name) - 1);
   hdr.max_pages = pages;
+  hdr.eof_hint = EOF_HINT_VALID;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
 
+#if COFFEE_NAME_INDEX_SIZE > 0
+  if(!HDR_LOG(hdr)) {
+    name_index_add(name, page);
+  }
+#endif
+
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
       pages, page, name);
 
@@ -823,6 +1346,7 @@ merge_log(coffee_page_t file_page, int extend)
     cfs_close(fd);
     return -1;
   }
+  eof_hint_update(new_file, coffee_fd_set[fd].file->end);
 
   offset = 0;
   do {
@@ -1181,6 +1705,9 @@ cfs_write(int fd, const void *buf, unsigned size)
   }
 #endif
 
+  /* Update the EOF hint before writing so that it is never behind. */
+  eof_hint_update(file, fdp->offset + size);
+
 #if COFFEE_MICRO_LOGS
 #if COFFEE_IO_SEMANTICS
   if(!(fdp->io_flags & CFS_COFFEE_IO_FLASH_AWARE) &&
@@ -1202,6 +1729,7 @@ cfs_write(int fd, const void *buf, unsigned size)
       } else if(i == 0) {
         /* The file was merged with the log. */
 	file = fdp->file;
+	eof_hint_update(file, fdp->offset + bytes_left);
       } else {
 	/* A log record was written. */
 	bytes_left -= i;
@@ -1345,17 +1873,69 @@ cfs_coffee_format(void)
 
   for(i = 0; i < COFFEE_SECTOR_COUNT; i++) {
     COFFEE_ERASE(i);
+#if COFFEE_BACKGROUND_GC
+    count_erase(i);
+#endif
     PRINTF(".");
   }
 
   /* Formatting invalidates the file information. */
   memset(&protected_mem, 0, sizeof(protected_mem));
+#if COFFEE_NAME_INDEX_SIZE > 0
+  name_index_state = NAME_INDEX_EMPTY;
+#endif
 
   PRINTF(" done!\n");
 
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+int
+cfs_coffee_get_stats(struct cfs_coffee_stats *stats)
+{
+  uint16_t sector;
+  struct sector_status status;
+  unsigned free_extent;
+
+  memset(stats, 0, sizeof(*stats));
+  free_extent = 0;
+#if COFFEE_BACKGROUND_GC
+  wear_log_read();
+#endif
+
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    get_sector_status(sector, &status);
+    stats->active_pages += status.active;
+    stats->obsolete_pages += status.obsolete;
+    stats->free_pages += status.free;
+    if(status.active == 0 && status.free == 0) {
+      stats->erasable_sectors++;
+    }
+
+    /* The free pages of a sector are at its end, so a free extent
+       continues only through sectors that are completely free. */
+    if(status.free == COFFEE_PAGES_PER_SECTOR) {
+      free_extent += status.free;
+    } else {
+      free_extent = status.free;
+    }
+    if(free_extent > stats->largest_free_extent) {
+      stats->largest_free_extent = free_extent;
+    }
+
+#if COFFEE_BACKGROUND_GC
+    if(sector == 0 || sector_erases[sector] < stats->min_erases) {
+      stats->min_erases = sector_erases[sector];
+    }
+    if(sector_erases[sector] > stats->max_erases) {
+      stats->max_erases = sector_erases[sector];
+    }
+#endif
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 void *
 cfs_coffee_get_protected_mem(unsigned *size)
 {
@@ -126,6 +126,38 @@ int cfs_coffee_set_io_semantics(int fd, unsigned flags);
  */
 int cfs_coffee_format(void);
 
+/**
+ * Storage usage reported by cfs_coffee_get_stats(). All sizes are
+ * counted in pages.
+ */
+struct cfs_coffee_stats {
+  /** Pages that belong to existing files and their logs. */
+  unsigned active_pages;
+  /** Pages of removed files that have not been erased yet. */
+  unsigned obsolete_pages;
+  /** Erased pages available for new files. */
+  unsigned free_pages;
+  /** The largest number of consecutive free pages. A file larger than
+      this cannot be reserved without collecting garbage first. */
+  unsigned largest_free_extent;
+  /** Sectors with only obsolete pages, which the garbage collector
+      can erase without reducing the free space. */
+  unsigned erasable_sectors;
+  /** The lowest and highest number of times a sector has been erased.
+      Only counted if COFFEE_BACKGROUND_GC is set. */
+  unsigned min_erases;
+  unsigned max_erases;
+};
+
+/**
+ * \brief Report the usage and fragmentation of the storage.
+ * \param stats A pointer to a structure that is filled in.
+ * \return 0 on success, -1 on failure.
+ * The function reads the header of every file in the storage, so it
+ * should not be called on performance critical paths.
+ */
+int cfs_coffee_get_stats(struct cfs_coffee_stats *stats);
+
 /**
  * \brief Points out a memory region that may not be altered during
  * checkpointing operations that use the file system.
@@ -81,10 +81,13 @@ unsigned short crc16_add(unsigned char b, unsigned short crc);
  *
  *             This function calculates the CRC16 checksum of a data area.
  *
- *             \note The algorithm used in this implementation is
- *             tailored for a running checksum and does not perform as
- *             well as a table-driven algorithm when checksumming an
- *             entire data block.
+ *             \note By default, the algorithm used in this
+ *             implementation is tailored for a running checksum and
+ *             does not perform as well as a table-driven algorithm
+ *             when checksumming an entire data block. Define
+ *             CRC16_CONF_TABLE to 1 to use a table-driven algorithm
+ *             instead, and CRC16_CONF_SLICES to 4 or 8 to also
+ *             process several bytes per step on 32-bit targets.
  */
 unsigned short crc16_data(const unsigned char *data, int datalen,
 			  unsigned short acc);
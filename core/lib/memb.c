@@ -53,6 +53,28 @@ memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_FREELIST
+  m->free = 0;
+  m->top = 0;
+#endif /* MEMB_FREELIST */
+#if MEMB_STATS
+  m->used = 0;
+  m->max_used = 0;
+#endif /* MEMB_STATS */
+}
+/*---------------------------------------------------------------------------*/
+static void *
+alloc_block(struct memb *m, int i)
+{
+  /* Increase the reference count to indicate that the block now is
+     used and return a pointer to the memory block. */
+  ++(m->count[i]);
+#if MEMB_STATS
+  if(++m->used > m->max_used) {
+    m->max_used = m->used;
+  }
+#endif /* MEMB_STATS */
+  return (void *)((char *)m->mem + (i * m->size));
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -60,15 +82,23 @@ memb_alloc(struct memb *m)
 {
   int i;
 
+#if MEMB_FREELIST
+  if(m->free != 0) {
+    /* Take the first block in the free list. */
+    i = m->free - 1;
+    m->free = m->next[i];
+    return alloc_block(m, i);
+  }
+  if(m->top < m->num) {
+    return alloc_block(m, m->top++);
+  }
+#else /* MEMB_FREELIST */
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
-      /* If this block was unused, we increase the reference count to
-	 indicate that it now is used and return a pointer to the
-	 memory block. */
-      ++(m->count[i]);
-      return (void *)((char *)m->mem + (i * m->size));
+      return alloc_block(m, i);
     }
   }
+#endif /* MEMB_FREELIST */
 
   /* No free block was found, so we return NULL to indicate failure to
      allocate block. */
@@ -79,25 +109,31 @@ char
 memb_free(struct memb *m, void *ptr)
 {
   int i;
-  char *ptr2;
 
-  /* Walk through the list of blocks and try to find the block to
-     which the pointer "ptr" points to. */
-  ptr2 = (char *)m->mem;
-  for(i = 0; i < m->num; ++i) {
-    
-    if(ptr2 == (char *)ptr) {
-      /* We've found to block to which "ptr" points so we decrease the
-	 reference count and return the new value of it. */
-      if(m->count[i] > 0) {
-	/* Make sure that we don't deallocate free memory. */
-	--(m->count[i]);
-      }
-      return m->count[i];
+  /* The blocks are of equal size and consecutive, so the index of the
+     block to which "ptr" points is computed directly. */
+  if(!memb_inmemb(m, ptr) ||
+     ((char *)ptr - (char *)m->mem) % m->size != 0) {
+    return -1;
+  }
+  i = ((char *)ptr - (char *)m->mem) / m->size;
+
+  /* Make sure that we don't deallocate free memory. */
+  if(m->count[i] > 0) {
+    --(m->count[i]);
+    if(m->count[i] == 0) {
+#if MEMB_STATS
+      --m->used;
+#endif /* MEMB_STATS */
+#if MEMB_FREELIST
+      m->next[i] = m->free;
+      m->free = i + 1;
+#endif /* MEMB_FREELIST */
     }
-    ptr2 += m->size;
   }
-  return -1;
+
+  /* Return the new value of the reference count. */
+  return m->count[i];
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -65,6 +65,29 @@
 
 #include "sys/cc.h"
 
+/**
+ * If MEMB_CONF_FREELIST is set, free memory blocks are kept in a list
+ * so that memb_alloc() runs in constant time instead of scanning for
+ * a free block. The list is linked through a separate array of block
+ * indices, so freed blocks are left untouched.
+ */
+#ifdef MEMB_CONF_FREELIST
+#define MEMB_FREELIST MEMB_CONF_FREELIST
+#else /* MEMB_CONF_FREELIST */
+#define MEMB_FREELIST 0
+#endif /* MEMB_CONF_FREELIST */
+
+/**
+ * If MEMB_CONF_STATS is set, each memory block keeps track of the
+ * number of allocated blocks in the "used" field and of its highest
+ * value in the "max_used" field.
+ */
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else /* MEMB_CONF_STATS */
+#define MEMB_STATS 0
+#endif /* MEMB_CONF_STATS */
+
 /**
  * Declare a memory block.
  *
@@ -86,18 +109,43 @@ MEMB(connections, struct connection, 16);
  * \param num The total number of memory chunks in the block.
  *
  */
+#if MEMB_FREELIST
+#define MEMB(name, structure, num) \
+        static char CC_CONCAT(name,_memb_count)[num]; \
+        static structure CC_CONCAT(name,_memb_mem)[num]; \
+        static unsigned short CC_CONCAT(name,_memb_next)[num]; \
+        static struct memb name = {sizeof(structure), num, \
+                                          CC_CONCAT(name,_memb_count), \
+                                          (void *)CC_CONCAT(name,_memb_mem), \
+                                          CC_CONCAT(name,_memb_next)}
+#else /* MEMB_FREELIST */
 #define MEMB(name, structure, num) \
         static char CC_CONCAT(name,_memb_count)[num]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
                                           (void *)CC_CONCAT(name,_memb_mem)}
+#endif /* MEMB_FREELIST */
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_FREELIST
+  /* For each free block, one more than the index of the next free
+     block, or 0. */
+  unsigned short *next;
+  /* One more than the index of the first free block, or 0. */
+  unsigned short free;
+  /* The blocks from this index on have not been allocated since
+     memb_init() and are not in the free list. */
+  unsigned short top;
+#endif /* MEMB_FREELIST */
+#if MEMB_STATS
+  unsigned short used;
+  unsigned short max_used;
+#endif /* MEMB_STATS */
 };
 
 /**
@@ -55,10 +55,29 @@
 #define MMEM_SIZE 4096
 #endif
 
+/*
+ * With lazy compaction, mmem_free() leaves a hole where the block was
+ * instead of moving all later blocks down. The memory is compacted
+ * when mmem_alloc() cannot place a block after the last one, or when
+ * mmem_compact() is called, e.g. when the system is idle.
+ */
+#ifdef MMEM_CONF_LAZY_COMPACTION
+#define MMEM_LAZY_COMPACTION MMEM_CONF_LAZY_COMPACTION
+#else
+#define MMEM_LAZY_COMPACTION 0
+#endif
+
 LIST(mmemlist);
 unsigned int avail_memory;
 static char memory[MMEM_SIZE];
 
+#if MMEM_LAZY_COMPACTION
+/* The offset after the last allocated block. Holes below it are
+   reclaimed by compaction. */
+static unsigned int top;
+#endif /* MMEM_LAZY_COMPACTION */
+static unsigned int compactions;
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Allocate a managed memory block
@@ -87,13 +106,25 @@ mmem_alloc(struct mmem *m, unsigned int size)
     return 0;
   }
 
+#if MMEM_LAZY_COMPACTION
+  /* Reclaim the holes if the block does not fit after the last one. */
+  if(MMEM_SIZE - top < size) {
+    mmem_compact();
+  }
+#endif /* MMEM_LAZY_COMPACTION */
+
   /* We had enough memory so we add this memory block to the end of
      the list of allocated memory blocks. */
   list_add(mmemlist, m);
 
   /* Set up the pointer so that it points to the first available byte
      in the memory block. */
+#if MMEM_LAZY_COMPACTION
+  m->ptr = &memory[top];
+  top += size;
+#else /* MMEM_LAZY_COMPACTION */
   m->ptr = &memory[MMEM_SIZE - avail_memory];
+#endif /* MMEM_LAZY_COMPACTION */
 
   /* Remember the size of this memory block. */
   m->size = size;
@@ -120,6 +151,19 @@ mmem_free(struct mmem *m)
 {
   struct mmem *n;
 
+#if MMEM_LAZY_COMPACTION
+  avail_memory += m->size;
+  list_remove(mmemlist, m);
+
+  /* Only the memory after the new last block is reclaimed now. The
+     block leaves a hole if other blocks follow it. */
+  n = list_tail(mmemlist);
+  if(n == NULL) {
+    top = 0;
+  } else {
+    top = (char *)n->ptr + n->size - memory;
+  }
+#else /* MMEM_LAZY_COMPACTION */
   if(m->next != NULL) {
     /* Compact the memory after the allocation that is to be removed
        by moving it downwards. */
@@ -137,6 +181,67 @@ mmem_free(struct mmem *m)
 
   /* Remove the memory block from the list. */
   list_remove(mmemlist, m);
+#endif /* MMEM_LAZY_COMPACTION */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Compact the managed memory
+ *
+ *             This function moves the allocated blocks down to fill
+ *             the holes left by mmem_free(), so that all free memory
+ *             is in one piece. It does nothing unless lazy compaction
+ *             is enabled with MMEM_CONF_LAZY_COMPACTION, as the memory
+ *             is otherwise always compact. The pointers of the blocks
+ *             may change.
+ *
+ */
+void
+mmem_compact(void)
+{
+#if MMEM_LAZY_COMPACTION
+  struct mmem *n;
+  char *ptr;
+
+  if(top == MMEM_SIZE - avail_memory) {
+    /* There are no holes. */
+    return;
+  }
+
+  /* The list is ordered by address, so each block is moved down to
+     the end of the previous one. */
+  ptr = memory;
+  for(n = list_head(mmemlist); n != NULL; n = n->next) {
+    if(n->ptr != ptr) {
+      memmove(ptr, n->ptr, n->size);
+      n->ptr = ptr;
+    }
+    ptr += n->size;
+  }
+  top = ptr - memory;
+  compactions++;
+#endif /* MMEM_LAZY_COMPACTION */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Get statistics about the managed memory
+ * \param stats A pointer to a structure that is filled in.
+ *
+ *             This function reports the amount of free memory, how
+ *             much of it is in holes that need compaction before they
+ *             can be used, and how many times the memory has been
+ *             compacted.
+ *
+ */
+void
+mmem_get_stats(struct mmem_stats *stats)
+{
+  stats->avail = avail_memory;
+#if MMEM_LAZY_COMPACTION
+  stats->holes = top - (MMEM_SIZE - avail_memory);
+#else /* MMEM_LAZY_COMPACTION */
+  stats->holes = 0;
+#endif /* MMEM_LAZY_COMPACTION */
+  stats->compactions = compactions;
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -153,6 +258,10 @@ mmem_init(void)
 {
   list_init(mmemlist);
   avail_memory = MMEM_SIZE;
+#if MMEM_LAZY_COMPACTION
+  top = 0;
+#endif /* MMEM_LAZY_COMPACTION */
+  compactions = 0;
 }
 /*---------------------------------------------------------------------------*/
 
@@ -80,12 +80,27 @@ struct mmem {
   void *ptr;
 };
 
+/**
+ * Statistics reported by mmem_get_stats(). All sizes are in bytes.
+ */
+struct mmem_stats {
+  /** The total amount of free memory. */
+  unsigned int avail;
+  /** The part of the free memory that is in holes between blocks and
+      can only be used after compaction. */
+  unsigned int holes;
+  /** The number of times the memory has been compacted. */
+  unsigned int compactions;
+};
+
 /* XXX: tagga minne med "interrupt usage", vilke gr att man r
    speciellt varsam under free(). */
 
 int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
 void mmem_init(void);
+void mmem_compact(void);
+void mmem_get_stats(struct mmem_stats *stats);
 
 #endif /* MMEM_H_ */
 
@@ -283,7 +283,9 @@ packet_sent(void *ptr, int status, int num_transmissions)
                      transmit_packet_list, n);
           /* This is needed to correctly attribute energy that we spent
              transmitting this packet. */
-          queuebuf_update_attr_from_packetbuf(q->buf);
+          if(!queuebuf_update_attr_from_packetbuf(q->buf)) {
+            PRINTF("csma: could not update the attributes of %p\n", q);
+          }
         } else {
           PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
@@ -62,6 +62,17 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH
+/* Hash index of the keys, using open addressing with linear probing.
+ * Each slot holds the neighbor index plus one, or zero if empty. */
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t nbr_table_slot_t;
+#else
+typedef uint16_t nbr_table_slot_t;
+#endif
+static nbr_table_slot_t hash_slots[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -105,6 +116,65 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH
+/* Get the home slot of a link-layer address in the hash index */
+static int
+hash_from_lladdr(const rimeaddr_t *lladdr)
+{
+  uint16_t h = 0;
+  int i;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h = h * 31 + lladdr->u8[i];
+  }
+  return h % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a key to the hash index */
+static void
+hash_add(nbr_table_key_t *key)
+{
+  int slot = hash_from_lladdr(&key->lladdr);
+  while(hash_slots[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_slots[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a key from the hash index */
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  int slot, next, home;
+  nbr_table_slot_t value = index_from_key(key) + 1;
+
+  slot = hash_from_lladdr(&key->lladdr);
+  while(hash_slots[slot] != value) {
+    if(hash_slots[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_slots[slot] = 0;
+
+  /* Move back the entries that follow in the probe sequence, so that
+   * lookups do not stop at the slot we just emptied */
+  next = slot;
+  while(1) {
+    next = (next + 1) % NBR_TABLE_HASH_SIZE;
+    if(hash_slots[next] == 0) {
+      break;
+    }
+    home = hash_from_lladdr(&key_from_index(hash_slots[next] - 1)->lladdr);
+    if((next > slot && (home <= slot || home > next)) ||
+       (next < slot && (home <= slot && home > next))) {
+      hash_slots[slot] = hash_slots[next];
+      hash_slots[next] = 0;
+      slot = next;
+    }
+  }
+}
+#endif /* NBR_TABLE_HASH */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const rimeaddr_t *lladdr)
@@ -115,6 +185,18 @@ index_from_lladdr(const rimeaddr_t *lladdr)
   if(lladdr == NULL) {
     lladdr = &rimeaddr_null;
   }
+#if NBR_TABLE_HASH
+  {
+    int slot = hash_from_lladdr(lladdr);
+    while(hash_slots[slot] != 0) {
+      key = key_from_index(hash_slots[slot] - 1);
+      if(rimeaddr_cmp(lladdr, &key->lladdr)) {
+        return hash_slots[slot] - 1;
+      }
+      slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+    }
+  }
+#else /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && rimeaddr_cmp(lladdr, &key->lladdr)) {
@@ -122,6 +204,7 @@ index_from_lladdr(const rimeaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_HASH */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -218,6 +301,9 @@ nbr_table_allocate(void)
       used_map[index_from_key(least_used_key)] = 0;
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH
+      hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH */
       /* Return associated key */
       return least_used_key;
     }
@@ -298,6 +384,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const rimeaddr_t *lladdr)
 
     /* Set link-layer address */
     rimeaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_add(key);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
@@ -73,6 +73,10 @@ struct queuebuf {
     int swap_id;
   };
 #endif
+#if QUEUEBUF_SMALL_NUM > 0
+  /* Non-NULL if the packet is stored in a small queuebuf. */
+  struct queuebuf_small *small_ptr;
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 };
 
 /* The actual queuebuf data */
@@ -83,6 +87,16 @@ struct queuebuf_data {
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
 };
 
+#if QUEUEBUF_SMALL_NUM > 0
+/* A small queuebuf holds the packet followed by the attributes that are
+   set, each stored as its type followed by its value. */
+struct queuebuf_small {
+  uint8_t len;
+  uint8_t attrlen;
+  uint8_t buf[QUEUEBUF_SMALL_SIZE];
+};
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+
 struct queuebuf_ref {
   uint16_t len;
   uint8_t *ref;
@@ -90,9 +104,12 @@ struct queuebuf_ref {
   uint8_t hdrlen;
 };
 
-MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
+MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM + QUEUEBUF_SMALL_NUM);
 MEMB(refbufmem, struct queuebuf_ref, QUEUEBUF_REF_NUM);
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+#if QUEUEBUF_SMALL_NUM > 0
+MEMB(bufsmallmem, struct queuebuf_small, QUEUEBUF_SMALL_NUM);
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 
 #if WITH_SWAP
 
@@ -288,6 +305,109 @@ queuebuf_load_to_ram(struct queuebuf *b)
   return b->ram_ptr;
 }
 #endif /* WITH_SWAP */
+#if QUEUEBUF_SMALL_NUM > 0
+/*---------------------------------------------------------------------------*/
+/* Store the attributes of the packetbuf that are set in a small
+   queuebuf, after the packet. Returns the number of bytes used, or -1
+   if the attributes do not fit. */
+static int
+small_attr_copyto(uint8_t *buf, int size)
+{
+  packetbuf_attr_t val;
+  uint8_t type;
+  int len;
+
+  len = 0;
+  for(type = 0; type < PACKETBUF_ADDR_FIRST; type++) {
+    val = packetbuf_attr(type);
+    if(val != 0) {
+      if(len + 1 + sizeof(packetbuf_attr_t) > size) {
+        return -1;
+      }
+      buf[len++] = type;
+      memcpy(&buf[len], &val, sizeof(packetbuf_attr_t));
+      len += sizeof(packetbuf_attr_t);
+    }
+  }
+  for(type = PACKETBUF_ADDR_FIRST; type < PACKETBUF_ATTR_MAX; type++) {
+    if(!rimeaddr_cmp(packetbuf_addr(type), &rimeaddr_null)) {
+      if(len + 1 + RIMEADDR_SIZE > size) {
+        return -1;
+      }
+      buf[len++] = type;
+      rimeaddr_copy((rimeaddr_t *)&buf[len], packetbuf_addr(type));
+      len += RIMEADDR_SIZE;
+    }
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* Find an attribute in a small queuebuf. Returns a pointer to its
+   value, or NULL if the attribute is not set. */
+static uint8_t *
+small_attr_find(struct queuebuf_small *s, uint8_t type)
+{
+  uint8_t *ptr, *end;
+
+  ptr = &s->buf[s->len];
+  end = ptr + s->attrlen;
+  while(ptr < end) {
+    if(*ptr == type) {
+      return ptr + 1;
+    }
+    ptr += 1 + (PACKETBUF_IS_ADDR(*ptr) ?
+                RIMEADDR_SIZE : sizeof(packetbuf_attr_t));
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+small_attr_copyfrom(struct queuebuf_small *s)
+{
+  uint8_t *ptr, *end;
+  packetbuf_attr_t val;
+
+  packetbuf_attr_clear();
+  ptr = &s->buf[s->len];
+  end = ptr + s->attrlen;
+  while(ptr < end) {
+    if(PACKETBUF_IS_ADDR(*ptr)) {
+      packetbuf_set_addr(*ptr, (rimeaddr_t *)(ptr + 1));
+      ptr += 1 + RIMEADDR_SIZE;
+    } else {
+      memcpy(&val, ptr + 1, sizeof(packetbuf_attr_t));
+      packetbuf_set_attr(*ptr, val);
+      ptr += 1 + sizeof(packetbuf_attr_t);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct queuebuf_small *
+small_new_from_packetbuf(void)
+{
+  struct queuebuf_small *s;
+  int len, attrlen;
+
+  len = packetbuf_totlen();
+  if(len > QUEUEBUF_SMALL_SIZE) {
+    return NULL;
+  }
+
+  s = memb_alloc(&bufsmallmem);
+  if(s == NULL) {
+    return NULL;
+  }
+
+  attrlen = small_attr_copyto(&s->buf[len], QUEUEBUF_SMALL_SIZE - len);
+  if(attrlen < 0) {
+    memb_free(&bufsmallmem, s);
+    return NULL;
+  }
+  s->len = packetbuf_copyto(s->buf);
+  s->attrlen = attrlen;
+  return s;
+}
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_init(void)
@@ -302,6 +422,9 @@ queuebuf_init(void)
   memb_init(&buframmem);
   memb_init(&bufmem);
   memb_init(&refbufmem);
+#if QUEUEBUF_SMALL_NUM > 0
+  memb_init(&bufsmallmem);
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 #if QUEUEBUF_STATS
   queuebuf_max_len = QUEUEBUF_NUM;
 #endif /* QUEUEBUF_STATS */
@@ -341,6 +464,15 @@ queuebuf_new_from_packetbuf(void)
       buf->line = line;
       buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
+#if QUEUEBUF_SMALL_NUM > 0
+      buf->small_ptr = small_new_from_packetbuf();
+      if(buf->small_ptr != NULL) {
+#if QUEUEBUF_STATS
+        ++queuebuf_len;
+#endif /* QUEUEBUF_STATS */
+        return buf;
+      }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
       buf->ram_ptr = memb_alloc(&buframmem);
 #if WITH_SWAP
       /* If the allocation failed, store the qbuf in swap files */
@@ -356,6 +488,10 @@ queuebuf_new_from_packetbuf(void)
 #else
       if(buf->ram_ptr == NULL) {
         PRINTF("queuebuf_new_from_packetbuf: could not queuebuf data\n");
+#if QUEUEBUF_DEBUG
+        list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
+        memb_free(&bufmem, buf);
         return NULL;
       }
       buframptr = buf->ram_ptr;
@@ -392,22 +528,61 @@ queuebuf_new_from_packetbuf(void)
   }
 }
 /*---------------------------------------------------------------------------*/
-void
+int
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_SMALL_NUM > 0
+  struct queuebuf_small *s;
+  int attrlen;
+
+  s = buf->small_ptr;
+  if(s != NULL) {
+    attrlen = small_attr_copyto(&s->buf[s->len], QUEUEBUF_SMALL_SIZE - s->len);
+    if(attrlen >= 0) {
+      s->attrlen = attrlen;
+      return 1;
+    }
+
+    /* The attributes no longer fit: move the packet to a regular
+       queuebuf. */
+    buframptr = memb_alloc(&buframmem);
+    if(buframptr == NULL) {
+      PRINTF("queuebuf_update_attr_from_packetbuf: could not move the packet\n");
+      return 0;
+    }
+    buframptr->len = s->len;
+    memcpy(buframptr->data, s->buf, s->len);
+    memb_free(&bufsmallmem, s);
+    buf->small_ptr = NULL;
+    buf->ram_ptr = buframptr;
+#if WITH_SWAP
+    buf->location = IN_RAM;
+#endif
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+
+  buframptr = queuebuf_load_to_ram(buf);
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
-    queuebuf_flush_tmpdata();
+    if(queuebuf_flush_tmpdata() == -1) {
+      return 0;
+    }
   }
 #endif
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_free(struct queuebuf *buf)
 {
   if(memb_inmemb(&bufmem, buf)) {
+#if QUEUEBUF_SMALL_NUM > 0
+    if(buf->small_ptr != NULL) {
+      memb_free(&bufsmallmem, buf->small_ptr);
+    } else
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 #if WITH_SWAP
     if(buf->location == IN_RAM) {
       memb_free(&buframmem, buf->ram_ptr);
@@ -438,7 +613,15 @@ queuebuf_to_packetbuf(struct queuebuf *b)
 {
   struct queuebuf_ref *r;
   if(memb_inmemb(&bufmem, b)) {
-    struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+    struct queuebuf_data *buframptr;
+#if QUEUEBUF_SMALL_NUM > 0
+    if(b->small_ptr != NULL) {
+      packetbuf_copyfrom(b->small_ptr->buf, b->small_ptr->len);
+      small_attr_copyfrom(b->small_ptr);
+      return;
+    }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+    buframptr = queuebuf_load_to_ram(b);
     packetbuf_copyfrom(buframptr->data, buframptr->len);
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
   } else if(memb_inmemb(&refbufmem, b)) {
@@ -456,7 +639,13 @@ queuebuf_dataptr(struct queuebuf *b)
   struct queuebuf_ref *r;
 
   if(memb_inmemb(&bufmem, b)) {
-    struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+    struct queuebuf_data *buframptr;
+#if QUEUEBUF_SMALL_NUM > 0
+    if(b->small_ptr != NULL) {
+      return b->small_ptr->buf;
+    }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+    buframptr = queuebuf_load_to_ram(b);
     return buframptr->data;
   } else if(memb_inmemb(&refbufmem, b)) {
     r = (struct queuebuf_ref *)b;
@@ -468,21 +657,55 @@ queuebuf_dataptr(struct queuebuf *b)
 int
 queuebuf_datalen(struct queuebuf *b)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_SMALL_NUM > 0
+  if(b->small_ptr != NULL) {
+    return b->small_ptr->len;
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  buframptr = queuebuf_load_to_ram(b);
   return buframptr->len;
 }
 /*---------------------------------------------------------------------------*/
 rimeaddr_t *
 queuebuf_addr(struct queuebuf *b, uint8_t type)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_SMALL_NUM > 0
+  static rimeaddr_t unset_addr;
+  uint8_t *ptr;
+
+  if(b->small_ptr != NULL) {
+    ptr = small_attr_find(b->small_ptr, type);
+    if(ptr == NULL) {
+      rimeaddr_copy(&unset_addr, &rimeaddr_null);
+      return &unset_addr;
+    }
+    return (rimeaddr_t *)ptr;
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  buframptr = queuebuf_load_to_ram(b);
   return &buframptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 queuebuf_attr(struct queuebuf *b, uint8_t type)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_SMALL_NUM > 0
+  packetbuf_attr_t val;
+  uint8_t *ptr;
+
+  if(b->small_ptr != NULL) {
+    ptr = small_attr_find(b->small_ptr, type);
+    if(ptr == NULL) {
+      return 0;
+    }
+    memcpy(&val, ptr, sizeof(val));
+    return val;
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  buframptr = queuebuf_load_to_ram(b);
   return buframptr->attrs[type].val;
 }
 /*---------------------------------------------------------------------------*/
@@ -79,6 +79,27 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* QUEUEBUF_SMALL_NUM is the number of additional queuebufs for short
+   packets. A small queuebuf holds QUEUEBUF_SMALL_SIZE bytes, which are
+   shared between the packet and the packet attributes that are set,
+   instead of a full PACKETBUF_SIZE buffer and all attributes. Packets
+   that do not fit are stored in the regular queuebufs. */
+#ifdef QUEUEBUF_CONF_SMALL_NUM
+#define QUEUEBUF_SMALL_NUM QUEUEBUF_CONF_SMALL_NUM
+#else
+#define QUEUEBUF_SMALL_NUM 0
+#endif
+
+#ifdef QUEUEBUF_CONF_SMALL_SIZE
+#define QUEUEBUF_SMALL_SIZE QUEUEBUF_CONF_SMALL_SIZE
+#else
+#define QUEUEBUF_SMALL_SIZE 64
+#endif
+
+#if QUEUEBUF_SMALL_SIZE > 255
+#error "QUEUEBUF_CONF_SMALL_SIZE must be less than 256"
+#endif
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -95,7 +116,9 @@ struct queuebuf *queuebuf_new_from_packetbuf_debug(const char *file, int line);
 #else /* QUEUEBUF_DEBUG */
 struct queuebuf *queuebuf_new_from_packetbuf(void);
 #endif /* QUEUEBUF_DEBUG */
-void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
+/* Returns zero if the attributes could not be stored, in which case
+   the queuebuf keeps its previous attributes. */
+int queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
@@ -67,6 +67,9 @@
 #include "net/sicslowpan.h"
 #include "net/netstack.h"
 #include "sys/ctimer.h"
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#endif /* UIP_CONF_IPV6_RPL */
 
 #if UIP_CONF_IPV6
 
@@ -153,6 +156,8 @@ void uip_log(char *msg);
 #define UIP_IP_BUF          ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_UDP_BUF          ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
 #define UIP_TCP_BUF          ((struct uip_tcp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+#define UIP_HBHO_BUF         ((struct uip_hbho_hdr *)&uip_buf[UIP_LLIPH_LEN])
+#define UIP_EXT_HDR_OPT_RPL_BUF ((struct uip_ext_hdr_opt_rpl *)&uip_buf[UIP_LLIPH_LEN + 2])
 #define UIP_ICMP_BUF          ((struct uip_icmp_hdr *)&uip_buf[UIP_LLIPH_LEN])
 /** @} */
 
@@ -221,35 +226,75 @@ static int last_tx_status;
  *  @{
  */
 
-static uint16_t sicslowpan_len;
+/**
+ * A reassembly context. Each context holds one IPv6 packet being
+ * reassembled (no MAC header, 6lowpan, etc), identified by the sender
+ * of the fragments, the datagram tag and the datagram size. The
+ * received parts of the packet are tracked in 8 byte blocks, so that
+ * duplicate fragments are not counted twice.
+ */
+struct sicslowpan_reass {
+  uip_buf_t buf;
+  /** Source address of the fragments being merged */
+  rimeaddr_t sender;
+  /** Size of the IPv6 packet, zero if the context is not in use */
+  uint16_t size;
+  /** The tag in the fragments being merged */
+  uint16_t tag;
+  /** Number of 8 byte blocks received so far */
+  uint16_t received;
+  /** One bit for each received 8 byte block */
+  uint8_t bitmap[(UIP_BUFSIZE + 63) / 64];
+  /** Reassembly %process %timer. */
+  struct timer timer;
+};
 
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * The reassembly contexts. They have a fix size as we do not use
+ * dynamic memory allocation.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+static struct sicslowpan_reass reass_contexts[SICSLOWPAN_REASS_CONTEXTS];
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+struct sicslowpan_reass_stats sicslowpan_reass_stats;
+
+#define FRAG_FORWARDING (UIP_CONF_ROUTER && SICSLOWPAN_FRAG_FORWARDING)
 
+#if FRAG_FORWARDING
 /**
- * length of the ip packet already sent / received.
- * It includes IP and transport headers.
+ * An entry of the fragment forwarding table. Once the first fragment
+ * of a packet that is not for us has been forwarded, the following
+ * fragments with the same sender, tag and size are relayed to the
+ * same next hop, under the tag we chose, without reassembling the
+ * packet.
  */
-static uint16_t processed_ip_in_len;
+struct sicslowpan_fwd {
+  /** Source address and tag of the fragments we receive */
+  rimeaddr_t sender;
+  uint16_t tag;
+  /** Size of the IPv6 packet, zero if the entry is not in use */
+  uint16_t size;
+  /** Where the fragments are relayed, and with which tag */
+  rimeaddr_t next_hop;
+  uint16_t next_tag;
+  /** Number of bytes of the packet relayed so far */
+  uint16_t relayed;
+  struct timer timer;
+};
 
-/** Datagram tag to be put in the fragments I send. */
-static uint16_t my_tag;
+static struct sicslowpan_fwd fwd_table[SICSLOWPAN_FRAG_FORWARDING_ENTRIES];
+#endif /* FRAG_FORWARDING */
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
+/**
+ * The buffer the received packet is decompressed into: the buffer of
+ * a reassembly context for fragments, uip_buf otherwise.
+ */
+static uint8_t *sicslowpan_buf;
 
-/** When reassembling, the source address of the fragments being merged */
-rimeaddr_t frag_sender;
+/** The total length of the IPv6 packet in the sicslowpan_buf. */
+static uint16_t sicslowpan_len;
 
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
+/** Datagram tag to be put in the fragments I send. */
+static uint16_t my_tag;
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
@@ -1462,6 +1507,54 @@ send_packet(rimeaddr_t *dest)
   watchdog_periodic();
 }
 /*--------------------------------------------------------------------*/
+/**
+ * \brief Compress the header of the IP packet in uip_buf into the
+ * beginning of packetbuf, with the compression scheme configured for
+ * this node.
+ * \param localdest The MAC address of the destination, NULL for broadcast
+ * \param dest The link layer destination address of the packet
+ */
+static void
+compress_hdr(const uip_lladdr_t *localdest, rimeaddr_t *dest)
+{
+  if(uip_len >= COMPRESSION_THRESHOLD) {
+    /* Try to compress the headers */
+	  if(localdest == NULL && ((uint8_t *)(&UIP_IP_BUF->destipaddr))[1] >> 4 ){ // broadcast packet --> use LOWPAN_BC0
+		  // check for transient ipv6 multicast address
+
+		  PRINTF("sicslowpan: Using BC0 compression.\n");
+		  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+		  compress_hdr_bc0(dest);
+	  }
+	  else{
+		#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1
+		  	PRINTF("sicslowpan: Using HC1 compression.\n");
+			compress_hdr_hc1(dest);
+		#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1 */
+		#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
+			PRINTF("sicslowpan: Using IPv6 compression.\n");
+			compress_hdr_ipv6(dest);
+		#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
+		#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+			PRINTF("sicslowpan: Using HC06.\n");
+			compress_hdr_hc06(dest);
+		#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+		  }
+  	  }
+  else
+  {
+	  if(localdest == NULL && ((uint8_t *)(&UIP_IP_BUF->destipaddr))[1] >> 4 ){ // broadcast packet --> use LOWPAN_BC0 if transient ipv6 multicast address
+		  PRINTF("sicslowpan: Using BC0 compression.");
+		  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+		  compress_hdr_bc0(dest);
+	  }
+	  else{
+		PRINTF("sicslowpan: else Using IPv6 compression.\n");
+		compress_hdr_ipv6(dest);
+	  }
+  }
+}
+/*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
  *  network using 6lowpan.
  *  \param localdest The MAC address of the destination
@@ -1529,42 +1622,7 @@ output(const uip_lladdr_t *localdest)
   
   PRINTFO("sicslowpan output: sending packet len %d\n", uip_len);
 
-  if(uip_len >= COMPRESSION_THRESHOLD) {
-    /* Try to compress the headers */
-	  if(localdest == NULL && ((uint8_t *)(&UIP_IP_BUF->destipaddr))[1] >> 4 ){ // broadcast packet --> use LOWPAN_BC0
-		  // check for transient ipv6 multicast address
-
-		  PRINTF("sicslowpan: Using BC0 compression.\n");
-		  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
-		  compress_hdr_bc0(&dest);
-	  }
-	  else{
-		#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1
-		  	PRINTF("sicslowpan: Using HC1 compression.\n");
-			compress_hdr_hc1(&dest);
-		#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1 */
-		#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
-			PRINTF("sicslowpan: Using IPv6 compression.\n");
-			compress_hdr_ipv6(&dest);
-		#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
-		#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
-			PRINTF("sicslowpan: Using HC06.\n");
-			compress_hdr_hc06(&dest);
-		#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
-		  }
-  	  }
-  else
-  {
-	  if(localdest == NULL && ((uint8_t *)(&UIP_IP_BUF->destipaddr))[1] >> 4 ){ // broadcast packet --> use LOWPAN_BC0 if transient ipv6 multicast address
-		  PRINTF("sicslowpan: Using BC0 compression.");
-		  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
-		  compress_hdr_bc0(&dest);
-	  }
-	  else{
-		PRINTF("sicslowpan: else Using IPv6 compression.\n");
-		compress_hdr_ipv6(&dest);
-	  }
-  }
+  compress_hdr(localdest, &dest);
 
   PRINTFO("sicslowpan output: header of len %d\n", rime_hdr_len);
 
@@ -1715,6 +1773,339 @@ output(const uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/** \brief Free the reassembly contexts that have timed out */
+static void
+reass_timeout(void)
+{
+  struct sicslowpan_reass *reass;
+
+  for(reass = reass_contexts;
+      reass < &reass_contexts[SICSLOWPAN_REASS_CONTEXTS]; reass++) {
+    if(reass->size != 0 && timer_expired(&reass->timer)) {
+      PRINTFI("sicslowpan input: reassembly timed out (tag %d)\n", reass->tag);
+      reass->size = 0;
+      sicslowpan_reass_stats.timeouts++;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the reassembly context of a fragment
+ * \param first Non-zero if this is the first fragment, in which case a
+ * new context is allocated if none is found. If all contexts are in
+ * use, the oldest reassembly is discarded.
+ */
+static struct sicslowpan_reass *
+reass_lookup(const rimeaddr_t *sender, uint16_t tag, uint16_t size,
+             uint8_t first)
+{
+  struct sicslowpan_reass *reass, *free, *oldest;
+
+  free = oldest = NULL;
+  for(reass = reass_contexts;
+      reass < &reass_contexts[SICSLOWPAN_REASS_CONTEXTS]; reass++) {
+    if(reass->size == 0) {
+      free = reass;
+    } else if(reass->size == size && reass->tag == tag &&
+              rimeaddr_cmp(&reass->sender, sender)) {
+      return reass;
+    } else if(oldest == NULL ||
+              timer_remaining(&reass->timer) <
+              timer_remaining(&oldest->timer)) {
+      oldest = reass;
+    }
+  }
+
+  if(!first) {
+    return NULL;
+  }
+
+  if(free == NULL) {
+    /* We discard the oldest packet, and start reassembling the new
+     * packet. This lessens the negative impacts of too high
+     * SICSLOWPAN_REASS_MAXAGE. */
+    PRINTFI("sicslowpan input: discarding reassembly (tag %d)\n", oldest->tag);
+    free = oldest;
+    sicslowpan_reass_stats.dropped++;
+  }
+
+  free->size = size;
+  free->tag = tag;
+  free->received = 0;
+  memset(free->bitmap, 0, sizeof(free->bitmap));
+  rimeaddr_copy(&free->sender, sender);
+  timer_set(&free->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+          size, tag);
+  return free;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Mark the 8 byte blocks from \c first to \c end as received */
+static void
+reass_mark(struct sicslowpan_reass *reass, uint16_t first, uint16_t end)
+{
+  uint16_t i;
+
+  for(i = first; i < end; i++) {
+    if((reass->bitmap[i >> 3] & (1 << (i & 7))) == 0) {
+      reass->bitmap[i >> 3] |= 1 << (i & 7);
+      reass->received++;
+    }
+  }
+}
+#if FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/** \brief Find the forwarding table entry of a fragment */
+static struct sicslowpan_fwd *
+fwd_lookup(const rimeaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct sicslowpan_fwd *fwd;
+
+  for(fwd = fwd_table;
+      fwd < &fwd_table[SICSLOWPAN_FRAG_FORWARDING_ENTRIES]; fwd++) {
+    if(fwd->size != 0 && timer_expired(&fwd->timer)) {
+      fwd->size = 0;
+    }
+    if(fwd->size == size && fwd->tag == tag &&
+       rimeaddr_cmp(&fwd->sender, sender)) {
+      return fwd;
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Add a forwarding table entry, replacing the oldest one if
+    the table is full */
+static void
+fwd_add(const rimeaddr_t *sender, uint16_t tag, uint16_t size,
+        const rimeaddr_t *next_hop, uint16_t next_tag, uint16_t relayed)
+{
+  struct sicslowpan_fwd *fwd, *entry;
+
+  entry = NULL;
+  for(fwd = fwd_table;
+      fwd < &fwd_table[SICSLOWPAN_FRAG_FORWARDING_ENTRIES]; fwd++) {
+    if(fwd->size == 0 || timer_expired(&fwd->timer)) {
+      entry = fwd;
+      break;
+    }
+    if(entry == NULL ||
+       timer_remaining(&fwd->timer) < timer_remaining(&entry->timer)) {
+      entry = fwd;
+    }
+  }
+
+  rimeaddr_copy(&entry->sender, sender);
+  entry->tag = tag;
+  entry->size = size;
+  rimeaddr_copy(&entry->next_hop, next_hop);
+  entry->next_tag = next_tag;
+  entry->relayed = relayed;
+  timer_set(&entry->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Relay a fragment of a packet whose first fragment we have
+ * forwarded
+ * \return 1 if the fragment was handled, 0 if it is not part of a
+ * forwarded packet
+ *
+ * The fragment is in packetbuf. Only its tag is rewritten, as the
+ * offsets are in units of the uncompressed packet. A repeated first
+ * fragment is dropped, as we have already forwarded it.
+ */
+static uint8_t
+fwd_relay(uint16_t frag_tag, uint16_t frag_size, uint8_t frag_offset,
+          uint8_t first_fragment)
+{
+  struct sicslowpan_fwd *fwd;
+  rimeaddr_t next_hop;
+
+  fwd = fwd_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER), frag_tag, frag_size);
+  if(fwd == NULL) {
+    return 0;
+  }
+  if(first_fragment) {
+    PRINTFI("sicslowpan input: dropping repeated first fragment (tag %d)\n",
+            frag_tag);
+    return 1;
+  }
+
+  PRINTFI("sicslowpan input: relaying fragment (tag %d -> %d, offset %d)\n",
+          frag_tag, fwd->next_tag, frag_offset);
+  rimeaddr_copy(&next_hop, &fwd->next_hop);
+  fwd->relayed += packetbuf_datalen() - SICSLOWPAN_FRAGN_HDR_LEN;
+  if(fwd->relayed >= fwd->size) {
+    /* The whole packet has been relayed */
+    fwd->size = 0;
+  }
+
+  /* The MAC layer has stripped its header from packetbuf, make the
+     fragment contiguous again before it sends the packet */
+  packetbuf_compact();
+  packetbuf_attr_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  rime_ptr = packetbuf_dataptr();
+  SET16(RIME_FRAG_PTR, RIME_FRAG_TAG, fwd->next_tag);
+  send_packet(&next_hop);
+  sicslowpan_reass_stats.forwarded++;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward the first fragment of a packet that is not for us
+ * \param reass The context holding the beginning of the packet
+ * \param len The number of bytes of the packet in the first fragment
+ * \return 1 if the fragment was handled, 0 if the packet must be
+ * reassembled and handed to the IP stack
+ *
+ * The next hop is chosen like tcpip_ipv6_output() does, from the
+ * uncompressed IP header. Packets that uip6 would answer with an ICMP
+ * error, or whose next hop is not a known neighbor, are left to the
+ * IP stack.
+ */
+static uint8_t
+fwd_first(struct sicslowpan_reass *reass, uint16_t len)
+{
+  uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  uip_ds6_nbr_t *nbr;
+  rimeaddr_t dest;
+  struct queuebuf *received;
+  uint16_t payload_len;
+  int framer_hdrlen;
+
+  /* Work on a copy of the beginning of the packet in uip_buf, the
+     context is left untouched if we fall back to reassembly */
+  memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)&reass->buf.u8[UIP_LLH_LEN], len);
+  uip_len = reass->size;
+  uip_ext_len = 0;
+
+  if(len < UIP_IPH_LEN ||
+     uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_link_local(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_mcast(&UIP_IP_BUF->srcipaddr) ||
+     uip_is_addr_link_local(&UIP_IP_BUF->srcipaddr) ||
+     uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr) ||
+     UIP_IP_BUF->ttl <= 1 || uip_len > UIP_LINK_MTU) {
+    return 0;
+  }
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO) {
+#if UIP_CONF_IPV6_RPL
+    /* The only hop-by-hop option we process here is the RPL one */
+    if(len < UIP_IPH_LEN + 8 || UIP_HBHO_BUF->len != 0 ||
+       UIP_EXT_HDR_OPT_RPL_BUF->opt_type != UIP_EXT_HDR_OPT_RPL) {
+      return 0;
+    }
+#else /* UIP_CONF_IPV6_RPL */
+    return 0;
+#endif /* UIP_CONF_IPV6_RPL */
+  }
+
+  /* Next hop determination */
+  if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)) {
+    nexthop = &UIP_IP_BUF->destipaddr;
+  } else {
+    route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
+    if(route != NULL) {
+      nexthop = uip_ds6_route_nexthop(route);
+    } else {
+      nexthop = uip_ds6_defrt_choose();
+    }
+  }
+  if(nexthop == NULL) {
+    return 0;
+  }
+  nbr = uip_ds6_nbr_lookup(nexthop);
+  if(nbr == NULL || nbr->state == NBR_INCOMPLETE) {
+    return 0;
+  }
+  rimeaddr_copy(&dest, (const rimeaddr_t *)uip_ds6_nbr_get_ll(nbr));
+
+  /* Building the first fragment for the next hop overwrites the
+     received frame in packetbuf. It is saved so that a packet that
+     cannot be forwarded fragment by fragment is reassembled from the
+     frame exactly as it was received. */
+  received = queuebuf_new_from_packetbuf();
+  if(received == NULL) {
+    return 0;
+  }
+
+  /* Build a first fragment for the next hop: the header compressed
+     again, followed by the same part of the packet as the fragment
+     we received, so that the offsets of the following fragments do
+     not change. The hop limit is decremented first, as its
+     compression depends on its value. */
+  UIP_IP_BUF->ttl = UIP_IP_BUF->ttl - 1;
+  packetbuf_clear();
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+  framer_hdrlen = NETSTACK_FRAMER.create();
+  if(framer_hdrlen < 0) {
+    framer_hdrlen = 21;
+  }
+  packetbuf_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  rime_ptr = packetbuf_dataptr();
+  rime_hdr_len = 0;
+  uncomp_hdr_len = 0;
+  compress_hdr((const uip_lladdr_t *)&dest, &dest);
+
+  payload_len = len - uncomp_hdr_len;
+  if(uncomp_hdr_len > len ||
+     SICSLOWPAN_FRAG1_HDR_LEN + rime_hdr_len + payload_len >
+     MAC_MAX_PAYLOAD - framer_hdrlen) {
+    PRINTFI("sicslowpan input: first fragment cannot be forwarded\n");
+    UIP_IP_BUF->ttl = UIP_IP_BUF->ttl + 1;
+    queuebuf_to_packetbuf(received);
+    queuebuf_free(received);
+    return 0;
+  }
+  queuebuf_free(received);
+
+#if UIP_CONF_IPV6_RPL
+  /* The RPL option is updated in place and is not part of the
+     compressed header, so it is copied with the payload below. A
+     packet without one is forwarded as is, as inserting it would move
+     the following fragments. */
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO) {
+    if(rpl_verify_header(2)) {
+      PRINTFI("sicslowpan input: RPL option error, dropping fragment\n");
+      sicslowpan_reass_stats.dropped++;
+      return 1;
+    }
+    rpl_update_header_empty();
+    if(rpl_update_header_final(nexthop)) {
+      sicslowpan_reass_stats.dropped++;
+      return 1;
+    }
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+
+  memmove(rime_ptr + SICSLOWPAN_FRAG1_HDR_LEN, rime_ptr, rime_hdr_len);
+  SET16(RIME_FRAG_PTR, RIME_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | reass->size));
+  SET16(RIME_FRAG_PTR, RIME_FRAG_TAG, my_tag);
+  rime_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  memcpy(rime_ptr + rime_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
+         payload_len);
+  packetbuf_set_datalen(rime_hdr_len + payload_len);
+
+  PRINTFI("sicslowpan input: forwarding first fragment (tag %d -> %d)\n",
+          reass->tag, my_tag);
+  fwd_add(&reass->sender, reass->tag, reass->size, &dest, my_tag, len);
+  my_tag++;
+  send_packet(&dest);
+  sicslowpan_reass_stats.forwarded++;
+  return 1;
+}
+#endif /* FRAG_FORWARDING */
+#endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1740,7 +2131,9 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   /* tag of the fragment */
   uint16_t frag_tag = 0;
-  uint8_t first_fragment = 0, last_fragment = 0;
+  uint8_t first_fragment = 0;
+  /* the context the fragment is reassembled in */
+  struct sicslowpan_reass *reass = NULL;
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* init */
@@ -1754,11 +2147,8 @@ input(void)
      want to query us for it later. */
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
 #if SICSLOWPAN_CONF_FRAG
-  /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
+  /* cancel the reassemblies that timed out */
+  reass_timeout();
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1774,7 +2164,7 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       rime_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
-      /*      printf("frag1 %d %d\n", reass_tag, frag_tag);*/
+      /*      printf("frag1 %d\n", frag_tag);*/
       first_fragment = 1;
       is_fragment = 1;
       break;
@@ -1790,77 +2180,41 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       rime_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      PRINTFI("last_fragment?: processed_ip_in_len %d rime_payload_len %d frag_size %d\n",
-              processed_ip_in_len, packetbuf_datalen() - rime_hdr_len, frag_size);
-
-      if(processed_ip_in_len + packetbuf_datalen() - rime_hdr_len >= frag_size) {
-        last_fragment = 1;
-      }
       is_fragment = 1;
       break;
     default:
       break;
   }
 
-  /* We are currently reassembling a packet, but have just received the first
-   * fragment of another packet. We can either ignore it and hope to receive
-   * the rest of the under-reassembly packet fragments, or we can discard the
-   * previous packet altogether, and start reassembling the new packet.
-   *
-   * We discard the previous packet, and start reassembling the new packet.
-   * This lessens the negative impacts of too high SICSLOWPAN_REASS_MAXAGE.
-   */
-#define PRIORITIZE_NEW_PACKETS 1
-#if PRIORITIZE_NEW_PACKETS
-
-  if(!is_fragment) {
-    /* Prioritize non-fragment packets too. */
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  } else if(processed_ip_in_len > 0 && first_fragment
-      && !rimeaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
-#endif /* PRIORITIZE_NEW_PACKETS */
-
-  if(processed_ip_in_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !rimeaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
+#if FRAG_FORWARDING
+  if(is_fragment &&
+     fwd_relay(frag_tag, frag_size, frag_offset, first_fragment)) {
+    return;
+  }
+#endif /* FRAG_FORWARDING */
+
+  if(is_fragment) {
+    if(frag_size == 0 || frag_size > UIP_BUFSIZE) {
+      PRINTFI("sicslowpan input: Dropping fragment with invalid size %d\n", frag_size);
+      sicslowpan_reass_stats.dropped++;
       return;
     }
-  } else {
-    /*
-     * reassembly is off
-     * start it if we received a fragment
-     */
-    if((frag_size > 0) && (frag_size <= UIP_BUFSIZE)) {
-      /* We are currently not reassembling a packet, but have received a packet fragment
-       * that is not the first one. */
-      if(is_fragment && !first_fragment) {
-        return;
-      }
-
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
-      rimeaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    /* Fragments from several senders may be reassembled at the same
+     * time, each in its own context. A fragment that is not the first
+     * one and does not belong to any packet being reassembled is
+     * dropped. */
+    reass = reass_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                         frag_tag, frag_size, first_fragment);
+    if(reass == NULL) {
+      PRINTFI("sicslowpan input: Dropping fragment of unknown packet (tag %d)\n", frag_tag);
+      sicslowpan_reass_stats.dropped++;
+      return;
     }
+    sicslowpan_buf = reass->buf.u8;
+  } else {
+    /* A packet that is not fragmented is uncompressed directly into
+       uip_buf. */
+    sicslowpan_buf = uip_buf;
   }
 
   if(rime_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
@@ -1947,53 +2301,60 @@ input(void)
   {
     int req_size = UIP_LLH_LEN + uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + rime_payload_len;
-    if(req_size > sizeof(sicslowpan_buf)) {
+    if(req_size > UIP_BUFSIZE) {
       PRINTF(
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
-          rime_payload_len, req_size, sizeof(sicslowpan_buf));
+          rime_payload_len, req_size, UIP_BUFSIZE);
       return;
     }
   }
 
   memcpy((uint8_t *)SICSLOWPAN_IP_BUF + uncomp_hdr_len + (uint16_t)(frag_offset << 3), rime_ptr + rime_hdr_len, rime_payload_len);
   
-  /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
-
 #if SICSLOWPAN_CONF_FRAG
-  if(frag_size > 0) {
-    /* Add the size of the header only for the first fragment. */
-    if(first_fragment != 0) {
-      processed_ip_in_len += uncomp_hdr_len;
-    }
+  if(reass != NULL) {
     /* For the last fragment, we are OK if there is extrenous bytes at
        the end of the packet. */
-    if(last_fragment != 0) {
-      processed_ip_in_len = frag_size;
-    } else {
-      processed_ip_in_len += rime_payload_len;
+    uint16_t end = (uint16_t)(frag_offset << 3) + uncomp_hdr_len +
+      rime_payload_len;
+    if(end > reass->size) {
+      end = reass->size;
+    }
+#if FRAG_FORWARDING
+    /* A packet for another node is forwarded fragment by fragment */
+    if(first_fragment && reass->received == 0) {
+      uint8_t forwarded = fwd_first(reass, uncomp_hdr_len + rime_payload_len);
+      uip_len = 0;
+      if(forwarded) {
+        reass->size = 0;
+        return;
+      }
+    }
+#endif /* FRAG_FORWARDING */
+    reass_mark(reass, frag_offset, (end + 7) >> 3);
+    PRINTF("reassembly tag %d: %d of %d blocks\n", reass->tag,
+           reass->received, (reass->size + 7) >> 3);
+    if(reass->received < ((reass->size + 7) >> 3)) {
+      return;
     }
-    PRINTF("processed_ip_in_len %d, rime_payload_len %d\n", processed_ip_in_len, rime_payload_len);
-
-  } else {
-#endif /* SICSLOWPAN_CONF_FRAG */
-    sicslowpan_len = rime_payload_len + uncomp_hdr_len;
-#if SICSLOWPAN_CONF_FRAG
-  }
 
-  /*
-   * If we have a full IP packet in sicslowpan_buf, deliver it to
-   * the IP stack
-   */
-  PRINTF("sicslowpan_init processed_ip_in_len %d, sicslowpan_len %d\n",
-         processed_ip_in_len, sicslowpan_len);
-  if(processed_ip_in_len == 0 || (processed_ip_in_len == sicslowpan_len)) {
+    /*
+     * We have a full IP packet in the reassembly buffer, deliver it
+     * to the IP stack
+     */
+    sicslowpan_len = reass->size;
+    reass->size = 0;
+    sicslowpan_reass_stats.reassembled++;
     PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
            sicslowpan_len);
     memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
     uip_len = sicslowpan_len;
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
+  } else {
+    uip_len = rime_payload_len + uncomp_hdr_len;
+  }
+#else /* SICSLOWPAN_CONF_FRAG */
+  sicslowpan_len = rime_payload_len + uncomp_hdr_len;
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 #if DEBUG
@@ -2016,9 +2377,6 @@ input(void)
 
     PRINTF("Calling TCPIP INPUT\n");
     tcpip_input();
-#if SICSLOWPAN_CONF_FRAG
-  }
-#endif /* SICSLOWPAN_CONF_FRAG */
 }
 /** @} */
 
@@ -322,6 +322,23 @@ struct sicslowpan_nh_compressor {
 
 int sicslowpan_get_last_rssi(void);
 
+#if SICSLOWPAN_CONF_FRAG
+/** \brief Counters of the 6lowpan fragment reassembly */
+struct sicslowpan_reass_stats {
+  /** Number of packets reassembled and delivered to the IP stack */
+  uint16_t reassembled;
+  /** Number of fragments dropped, and of reassemblies discarded to
+      make room for a new packet */
+  uint16_t dropped;
+  /** Number of reassemblies that timed out */
+  uint16_t timeouts;
+  /** Number of fragments forwarded without reassembling the packet */
+  uint16_t forwarded;
+};
+
+extern struct sicslowpan_reass_stats sicslowpan_reass_stats;
+#endif /* SICSLOWPAN_CONF_FRAG */
+
 extern const struct network_driver sicslowpan_driver;
 
 /*-------------------------------------------------------------------------*/
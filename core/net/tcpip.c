@@ -746,7 +746,7 @@ tcpip_ipv6_output(void)
 void
 tcpip_poll_udp(struct uip_udp_conn *conn)
 {
-  process_post(&tcpip_process, UDP_POLL, conn);
+  process_post_prio(&tcpip_process, UDP_POLL, conn, PROCESS_PRIO_NETWORK);
 }
 #endif /* UIP_UDP */
 /*---------------------------------------------------------------------------*/
@@ -754,7 +754,7 @@ tcpip_poll_udp(struct uip_udp_conn *conn)
 void
 tcpip_poll_tcp(struct uip_conn *conn)
 {
-  process_post(&tcpip_process, TCP_POLL, conn);
+  process_post_prio(&tcpip_process, TCP_POLL, conn, PROCESS_PRIO_NETWORK);
 }
 #endif /* UIP_TCP */
 /*---------------------------------------------------------------------------*/
@@ -65,6 +65,14 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_INDEX
+/* Host routes are hashed on their address, while routes to prefixes
+   are kept on the prefix_routes list. */
+static uip_ds6_route_t *route_index[UIP_DS6_ROUTE_INDEX_SIZE];
+static uip_ds6_route_t *prefix_routes;
+static uint32_t lookup_count;
+#endif /* UIP_DS6_ROUTE_INDEX */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/uip-debug.h"
@@ -136,11 +144,75 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_INDEX
+static uip_ds6_route_t **
+index_bucket(uip_ds6_route_t *r)
+{
+  uint16_t h;
+  int i;
+
+  if(r->length != 128) {
+    return &prefix_routes;
+  }
+
+  h = 0;
+  for(i = 0; i < sizeof(uip_ipaddr_t) / 2; i++) {
+    h ^= r->ipaddr.u16[i];
+  }
+  h ^= h >> 8;
+  return &route_index[h % UIP_DS6_ROUTE_INDEX_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **bucket;
+
+  bucket = index_bucket(r);
+  r->index_next = *bucket;
+  *bucket = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **rp;
+
+  for(rp = index_bucket(r); *rp != NULL; rp = &(*rp)->index_next) {
+    if(*rp == r) {
+      *rp = r->index_next;
+      r->index_next = NULL;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+least_recently_used(void)
+{
+  uip_ds6_route_t *r, *oldest;
+
+  oldest = uip_ds6_route_head();
+  for(r = oldest; r != NULL; r = uip_ds6_route_next(r)) {
+    if((uint32_t)(lookup_count - r->last_lookup) >
+       (uint32_t)(lookup_count - oldest->last_lookup)) {
+      oldest = r;
+    }
+  }
+  return oldest;
+}
+#endif /* UIP_DS6_ROUTE_INDEX */
+/*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_INDEX
+  memset(route_index, 0, sizeof(route_index));
+  prefix_routes = NULL;
+  lookup_count = 0;
+#endif /* UIP_DS6_ROUTE_INDEX */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -209,6 +281,31 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 
   found_route = NULL;
   longestmatch = 0;
+#if UIP_DS6_ROUTE_INDEX
+  /* A host route is always the longest match, so we first look for
+     one in the hash table before we check the prefix routes. */
+  {
+    uip_ds6_route_t key;
+
+    key.length = 128;
+    uip_ipaddr_copy(&key.ipaddr, addr);
+    for(r = *index_bucket(&key); r != NULL; r = r->index_next) {
+      if(uip_ipaddr_cmp(addr, &r->ipaddr)) {
+        found_route = r;
+        break;
+      }
+    }
+  }
+  if(found_route == NULL) {
+    for(r = prefix_routes; r != NULL; r = r->index_next) {
+      if(r->length >= longestmatch &&
+         uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+        longestmatch = r->length;
+        found_route = r;
+      }
+    }
+  }
+#else /* UIP_DS6_ROUTE_INDEX */
   for(r = uip_ds6_route_head();
       r != NULL;
       r = uip_ds6_route_next(r)) {
@@ -218,6 +315,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       found_route = r;
     }
   }
+#endif /* UIP_DS6_ROUTE_INDEX */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -230,12 +328,18 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
   }
 
   if(found_route != NULL) {
+#if UIP_DS6_ROUTE_INDEX
+    /* Instead of reordering the route list, we remember when the
+       route was last used. */
+    found_route->last_lookup = ++lookup_count;
+#else /* UIP_DS6_ROUTE_INDEX */
     /* If we found a route, we put it at the end of the routeslist
        list. The list is ordered by how recently we looked them up:
        the least recently used route will be at the start of the
        list. */
     list_remove(routelist, found_route);
     list_add(routelist, found_route);
+#endif /* UIP_DS6_ROUTE_INDEX */
   }
 
   return found_route;
@@ -269,6 +373,11 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
     PRINTF("uip_ds6_route_add: old route already found, updating this one instead: ");
     PRINT6ADDR(ipaddr);
     PRINTF("\n");
+#if UIP_DS6_ROUTE_INDEX
+    /* The address and length may change, so the route is indexed
+       again below. */
+    index_remove(r);
+#endif /* UIP_DS6_ROUTE_INDEX */
   } else {
     struct uip_ds6_route_neighbor_routes *routes;
     /* If there is no routing entry, create one. We first need to
@@ -280,7 +389,11 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
          least recently used route is the first route on the list. */
       uip_ds6_route_t *oldest;
 
+#if UIP_DS6_ROUTE_INDEX
+      oldest = least_recently_used();
+#else /* UIP_DS6_ROUTE_INDEX */
       oldest = uip_ds6_route_head();
+#endif /* UIP_DS6_ROUTE_INDEX */
       PRINTF("uip_ds6_route_add: dropping route to ");
       PRINT6ADDR(&oldest->ipaddr);
       PRINTF("\n");
@@ -348,6 +461,10 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_INDEX
+  r->last_lookup = lookup_count;
+  index_add(r);
+#endif /* UIP_DS6_ROUTE_INDEX */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -386,6 +503,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the neighbor from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_INDEX
+    index_remove(route);
+#endif /* UIP_DS6_ROUTE_INDEX */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -80,6 +80,25 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/** \brief Index the routing table to speed up route lookups. Host
+    routes (/128) are kept in a hash table and prefix routes on a
+    separate list, and the least recently used route is found from a
+    per-route lookup counter instead of by reordering the route list on
+    every lookup. This is useful for nodes with large routing tables,
+    such as RPL roots in storing mode. */
+#ifdef UIP_CONF_DS6_ROUTE_INDEX
+#define UIP_DS6_ROUTE_INDEX UIP_CONF_DS6_ROUTE_INDEX
+#else /* UIP_CONF_DS6_ROUTE_INDEX */
+#define UIP_DS6_ROUTE_INDEX 0
+#endif /* UIP_CONF_DS6_ROUTE_INDEX */
+
+/** \brief The number of hash buckets for host routes */
+#ifdef UIP_CONF_DS6_ROUTE_INDEX_SIZE
+#define UIP_DS6_ROUTE_INDEX_SIZE UIP_CONF_DS6_ROUTE_INDEX_SIZE
+#else /* UIP_CONF_DS6_ROUTE_INDEX_SIZE */
+#define UIP_DS6_ROUTE_INDEX_SIZE 64
+#endif /* UIP_CONF_DS6_ROUTE_INDEX_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -108,6 +127,13 @@ typedef struct uip_ds6_route {
      belong to the neighbor table entry that this routing table entry
      uses. */
   struct uip_ds6_route_neighbor_routes *neighbor_routes;
+#if UIP_DS6_ROUTE_INDEX
+  /* The next route in the same hash bucket, or on the prefix route
+     list for routes shorter than 128 bits. */
+  struct uip_ds6_route *index_next;
+  /* The value of the lookup counter when the route was last used. */
+  uint32_t last_lookup;
+#endif /* UIP_DS6_ROUTE_INDEX */
   uip_ipaddr_t ipaddr;
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
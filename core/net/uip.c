@@ -267,6 +267,48 @@ uip_add32(uint8_t *op32, uint16_t op16)
 #endif /* UIP_ARCH_ADD32 */
 
 #if ! UIP_ARCH_CHKSUM
+#if UIP_CHKSUM_WIDE
+/*---------------------------------------------------------------------------*/
+static uint16_t
+chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint64_t acc;
+  uint32_t w;
+  uint16_t h;
+
+  /* The data is added in the byte order of the CPU, 32 bits at a
+     time, and the carries are folded back once at the end. On a
+     little endian CPU, this gives the byte swapped sum (RFC 1071). */
+  acc = uip_htons(sum);
+  while(len >= 8) {
+    memcpy(&w, data, 4);
+    acc += w;
+    memcpy(&w, data + 4, 4);
+    acc += w;
+    data += 8;
+    len -= 8;
+  }
+  while(len >= 2) {
+    memcpy(&h, data, 2);
+    acc += h;
+    data += 2;
+    len -= 2;
+  }
+  if(len > 0) {
+    h = 0;
+    memcpy(&h, data, 1);
+    acc += h;
+  }
+
+  acc = (acc >> 32) + (acc & 0xffffffff);
+  acc = (acc >> 16) + (acc & 0xffff);
+  acc = (acc >> 16) + (acc & 0xffff);
+  acc = (acc >> 16) + (acc & 0xffff);
+
+  /* Return sum in host byte order. */
+  return uip_ntohs((uint16_t)acc);
+}
+#else /* UIP_CHKSUM_WIDE */
 /*---------------------------------------------------------------------------*/
 static uint16_t
 chksum(uint16_t sum, const uint8_t *data, uint16_t len)
@@ -298,6 +340,7 @@ chksum(uint16_t sum, const uint8_t *data, uint16_t len)
   /* Return sum in host byte order. */
   return sum;
 }
+#endif /* UIP_CHKSUM_WIDE */
 /*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
@@ -368,6 +411,21 @@ uip_udpchksum(void)
 #endif /* UIP_ARCH_CHKSUM */
 /*---------------------------------------------------------------------------*/
 void
+uip_chksum_update(uint16_t *chksum, const void *olddata, const void *newdata,
+                  uint16_t len)
+{
+  uint32_t sum;
+
+  /* RFC 1624: HC' = ~(~HC + ~m + m') */
+  sum = (uint16_t)~uip_ntohs(*chksum);
+  sum += (uint16_t)~uip_ntohs(uip_chksum((uint16_t *)olddata, len));
+  sum += uip_ntohs(uip_chksum((uint16_t *)newdata, len));
+  sum = (sum >> 16) + (sum & 0xffff);
+  sum += sum >> 16;
+  *chksum = uip_htons((uint16_t)~sum);
+}
+/*---------------------------------------------------------------------------*/
+void
 uip_init(void)
 {
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
@@ -2162,6 +2162,23 @@ CCIF extern uip_lladdr_t uip_lladdr;
  */
 uint16_t uip_chksum(uint16_t *buf, uint16_t len);
 
+/**
+ * Update an Internet checksum after a part of the data it covers has
+ * been rewritten, without going through the whole data again (RFC
+ * 1624). This is useful when forwarding a packet changes only a few
+ * fields, such as the TTL or an address.
+ *
+ * \param chksum A pointer to the checksum field, in network byte
+ * order. It is updated in place.
+ * \param olddata The contents of the changed part before the change.
+ * \param newdata The contents of the changed part after the change.
+ * \param len The length of the changed part. It must start at an even
+ * offset in the checksummed data, and have an even length unless it
+ * ends the data.
+ */
+void uip_chksum_update(uint16_t *chksum, const void *olddata,
+                       const void *newdata, uint16_t len);
+
 /**
  * Calculate the IP header checksum of the packet header in uip_buf.
  *
@@ -468,6 +468,36 @@
 #define SICSLOWPAN_REASS_MAXAGE 20
 #endif
 
+/**
+ * Number of fragmented packets that can be reassembled at the same
+ * time. Each reassembly context needs a buffer of UIP_BUFSIZE bytes.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS (SICSLOWPAN_CONF_REASS_CONTEXTS)
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 1
+#endif
+
+/**
+ * Forward the fragments of packets that are not for this node as
+ * they arrive, instead of reassembling the packet before routing it
+ * (default: no). Only routers forward fragments.
+ */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING (SICSLOWPAN_CONF_FRAG_FORWARDING)
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+/**
+ * Number of packets whose fragments can be forwarded at the same time.
+ */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING_ENTRIES
+#define SICSLOWPAN_FRAG_FORWARDING_ENTRIES (SICSLOWPAN_CONF_FRAG_FORWARDING_ENTRIES)
+#else
+#define SICSLOWPAN_FRAG_FORWARDING_ENTRIES 4
+#endif
+
 /**
  * Do we compress the IP header or not (default: no)
  */
@@ -612,6 +642,20 @@ void uip_log(char *msg);
 #define UIP_BYTE_ORDER     (UIP_LITTLE_ENDIAN)
 #endif /* UIP_CONF_BYTE_ORDER */
 
+/**
+ * Compute the Internet checksum 32 bits at a time into a 64 bit
+ * accumulator, folding the carries once at the end instead of after
+ * every 16 bit word. This is faster on 32 and 64 bit CPUs, but not
+ * on 8 and 16 bit ones.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CHKSUM_WIDE
+#define UIP_CHKSUM_WIDE    (UIP_CONF_CHKSUM_WIDE)
+#else /* UIP_CONF_CHKSUM_WIDE */
+#define UIP_CHKSUM_WIDE    0
+#endif /* UIP_CONF_CHKSUM_WIDE */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 
@@ -49,6 +49,15 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+/*
+ * The list of pending event timers is kept sorted on the time
+ * remaining until each timer expires, with the first timer to expire
+ * at the head of the list. Timers that already have expired, but for
+ * which the event could not yet be posted, are kept at the head. This
+ * makes finding the next expiration time a constant-time operation
+ * and lets the etimer process stop walking the list at the first
+ * timer that has not expired.
+ */
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
@@ -57,29 +66,69 @@ PROCESS(etimer_process, "Event timer");
 static void
 update_time(void)
 {
-  clock_time_t tdist;
-  clock_time_t now;
+  if(timerlist == NULL) {
+    next_expiration = 0;
+  } else {
+    next_expiration = timerlist->timer.start + timerlist->timer.interval;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_timer(struct etimer *et)
+{
   struct etimer *t;
 
-  if (timerlist == NULL) {
-    next_expiration = 0;
+  if(et == timerlist) {
+    timerlist = timerlist->next;
   } else {
-    now = clock_time();
-    t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for(t = t->next; t != NULL; t = t->next) {
-      if(t->timer.start + t->timer.interval - now < tdist) {
-	tdist = t->timer.start + t->timer.interval - now;
-      }
+    for(t = timerlist; t != NULL && t->next != et; t = t->next);
+    if(t != NULL) {
+      t->next = et->next;
     }
-    next_expiration = now + tdist;
   }
+  et->next = NULL;
 }
 /*---------------------------------------------------------------------------*/
-PROCESS_THREAD(etimer_process, ev, data)
+static clock_time_t
+timer_remaining_at(struct timer *t, clock_time_t now)
+{
+  clock_time_t elapsed = now - t->start;
+
+  return elapsed < t->interval ? t->interval - elapsed : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *et)
 {
   struct etimer *t, *u;
+  clock_time_t now, remaining;
+
+  /* The clock is read once, and the remaining time of each timer is
+     computed from its elapsed time, which does not wrap. Expired
+     timers count as 0, so a new expired timer is inserted after the
+     other expired timers at the head of the list. */
+  now = clock_time();
+  remaining = timer_remaining_at(&et->timer, now);
+
+  u = NULL;
+  for(t = timerlist; t != NULL; t = t->next) {
+    if(timer_remaining_at(&t->timer, now) > remaining) {
+      break;
+    }
+    u = t;
+  }
+
+  et->next = t;
+  if(u != NULL) {
+    u->next = et;
+  } else {
+    timerlist = et;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  struct etimer *t;
 	
   PROCESS_BEGIN();
 
@@ -104,38 +153,32 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+      update_time();
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
-  again:
-    
-    u = NULL;
-    
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
-	  
-	  /* Reset the process ID of the event timer, to signal that the
-	     etimer has expired. This is later checked in the
-	     etimer_expired() function. */
-	  t->p = PROCESS_NONE;
-	  if(u != NULL) {
-	    u->next = t->next;
-	  } else {
-	    timerlist = t->next;
-	  }
-	  t->next = NULL;
-	  update_time();
-	  goto again;
-	} else {
-	  etimer_request_poll();
-	}
+    /* Since the list is sorted, the expired timers are all found at
+       the head of the list. */
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+
+	/* Reset the process ID of the event timer, to signal that the
+	   etimer has expired. This is later checked in the
+	   etimer_expired() function. */
+	t->p = PROCESS_NONE;
+	timerlist = t->next;
+	t->next = NULL;
+      } else {
+	/* The event queue is full. Leave the timer at the head of the
+	   list and try again later. */
+	etimer_request_poll();
+	break;
       }
-      u = t;
     }
-    
+    update_time();
   }
   
   PROCESS_END();
@@ -150,25 +193,16 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
-  struct etimer *t;
-
   etimer_request_poll();
 
   if(timer->p != PROCESS_NONE) {
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(t == timer) {
-	/* Timer already on list, bail out. */
-        timer->p = PROCESS_CURRENT();
-	update_time();
-	return;
-      }
-    }
+    /* The timer may already be on the list, but its expiration time
+       has changed so it must be moved to its new position. */
+    remove_timer(timer);
   }
 
-  /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
+  insert_timer(timer);
 
   update_time();
 }
@@ -198,6 +232,10 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+  if(et->p != PROCESS_NONE) {
+    remove_timer(et);
+    insert_timer(et);
+  }
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -234,29 +272,9 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
-  struct etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if(et == timerlist) {
-    timerlist = timerlist->next;
-    update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for(t = timerlist; t != NULL && t->next != et; t = t->next);
-
-    if(t != NULL) {
-      /* We've found the item before the event timer that we are about
-	 to remove. We point the items next pointer to the event after
-	 the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
-  }
+  remove_timer(et);
+  update_time();
 
-  /* Remove the next pointer from the item to be removed. */
-  et->next = NULL;
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
@@ -44,9 +44,11 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#include "lib/assert.h"
 
 /*
  * Pointer to the currently running process structure.
@@ -65,8 +67,22 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
-static struct event_data events[PROCESS_CONF_NUMEVENTS];
+/*
+ * There is one event queue per priority class. The queues are served
+ * in order of priority, but each class may only deliver a limited
+ * number of events before the lower priority classes get a turn, so
+ * that a busy high priority class cannot starve the others.
+ */
+static process_num_events_t nevents[PROCESS_PRIORITIES];
+static process_num_events_t fevent[PROCESS_PRIORITIES];
+static struct event_data events[PROCESS_PRIORITIES][PROCESS_CONF_NUMEVENTS];
+
+#if PROCESS_PRIORITIES > 1
+static const process_num_events_t budget[] = PROCESS_CONF_BUDGETS;
+/* PROCESS_CONF_BUDGETS must have one entry per priority class. */
+CTASSERT(sizeof(budget) / sizeof(budget[0]) == PROCESS_PRIORITIES);
+static process_num_events_t served[PROCESS_PRIORITIES];
+#endif /* PROCESS_PRIORITIES > 1 */
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
@@ -209,7 +225,11 @@ process_init(void)
 {
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  memset(nevents, 0, sizeof(nevents));
+  memset(fevent, 0, sizeof(fevent));
+#if PROCESS_PRIORITIES > 1
+  memset(served, 0, sizeof(served));
+#endif /* PROCESS_PRIORITIES > 1 */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -237,6 +257,55 @@ do_poll(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static process_num_events_t
+total_events(void)
+{
+#if PROCESS_PRIORITIES > 1
+  process_num_events_t n;
+  int i;
+
+  n = 0;
+  for(i = 0; i < PROCESS_PRIORITIES; i++) {
+    n += nevents[i];
+  }
+  return n;
+#else /* PROCESS_PRIORITIES > 1 */
+  return nevents[0];
+#endif /* PROCESS_PRIORITIES > 1 */
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Select the queue from which the next event should be taken, or -1
+ * if all queues are empty.
+ */
+static int
+next_queue(void)
+{
+#if PROCESS_PRIORITIES > 1
+  int i;
+
+  for(i = 0; i < PROCESS_PRIORITIES; i++) {
+    if(nevents[i] > 0 && served[i] < budget[i]) {
+      served[i]++;
+      return i;
+    }
+  }
+
+  /* All classes with pending events have used up their budgets, so
+     we start a new round. */
+  memset(served, 0, sizeof(served));
+  for(i = 0; i < PROCESS_PRIORITIES; i++) {
+    if(nevents[i] > 0) {
+      served[i]++;
+      return i;
+    }
+  }
+  return -1;
+#else /* PROCESS_PRIORITIES > 1 */
+  return nevents[0] > 0 ? 0 : -1;
+#endif /* PROCESS_PRIORITIES > 1 */
+}
+/*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
  * listening processes.
@@ -249,6 +318,7 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+  static int q;
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -258,18 +328,19 @@ do_event(void)
    * call the poll handlers inbetween.
    */
 
-  if(nevents > 0) {
+  q = next_queue();
+  if(q >= 0) {
     
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = events[q][fevent[q]].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = events[q][fevent[q]].data;
+    receiver = events[q][fevent[q]].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrese the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
-    --nevents;
+    fevent[q] = (fevent[q] + 1) % PROCESS_CONF_NUMEVENTS;
+    --nevents[q];
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
@@ -309,30 +380,59 @@ process_run(void)
   /* Process one event from the queue */
   do_event();
 
-  return nevents + poll_requested;
+  return total_events() + poll_requested;
+}
+/*---------------------------------------------------------------------------*/
+int
+process_run_batch(int max)
+{
+  while(max-- > 0) {
+    if(poll_requested) {
+      do_poll();
+    }
+    if(total_events() == 0) {
+      break;
+    }
+    do_event();
+  }
+
+  return total_events() + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
 int
 process_nevents(void)
 {
-  return nevents + poll_requested;
+  return total_events() + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
 int
 process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  return process_post_prio(p, ev, data,
+                           ev == PROCESS_EVENT_TIMER ?
+                           PROCESS_PRIO_TIMER : PROCESS_PRIO_APP);
+}
+/*---------------------------------------------------------------------------*/
+int
+process_post_prio(struct process *p, process_event_t ev, process_data_t data,
+                  unsigned char prio)
 {
   static process_num_events_t snum;
+  static unsigned char q;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
-	   ev,PROCESS_NAME_STRING(p), nevents);
+	   ev,PROCESS_NAME_STRING(p), total_events());
   } else {
     PRINTF("process_post: Process '%s' posts event %d to process '%s', nevents %d\n",
 	   PROCESS_NAME_STRING(PROCESS_CURRENT()), ev,
-	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
+	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), total_events());
   }
+
+  /* Classes that are not configured share the lowest priority queue. */
+  q = prio < PROCESS_PRIORITIES ? prio : PROCESS_PRIORITIES - 1;
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  if(nevents[q] == PROCESS_CONF_NUMEVENTS) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,15 +443,15 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
-  ++nevents;
+  snum = (process_num_events_t)(fevent[q] + nevents[q]) % PROCESS_CONF_NUMEVENTS;
+  events[q][snum].ev = ev;
+  events[q][snum].data = data;
+  events[q][snum].p = p;
+  ++nevents[q];
 
 #if PROCESS_CONF_STATS
-  if(nevents > process_maxevents) {
-    process_maxevents = nevents;
+  if(total_events() > process_maxevents) {
+    process_maxevents = total_events();
   }
 #endif /* PROCESS_CONF_STATS */
   
@@ -88,6 +88,54 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Event priority classes
+ *
+ * Asynchronous events are queued in one of several priority
+ * classes. By default there is only one class, and all events are
+ * delivered in the order they were posted. If PROCESS_CONF_PRIORITIES
+ * is set to a larger number, each class gets its own queue of
+ * PROCESS_CONF_NUMEVENTS events. The queues are served in order of
+ * priority, with at most PROCESS_CONF_BUDGETS[i] events delivered from
+ * class i before the lower priority classes get their turn. Classes
+ * above the configured number share the lowest priority queue. The
+ * budgets have a default for up to three classes; with more classes,
+ * PROCESS_CONF_BUDGETS must list one non-zero budget per class.
+ * @{
+ */
+#define PROCESS_PRIO_NETWORK  0
+#define PROCESS_PRIO_TIMER    1
+#define PROCESS_PRIO_APP      2
+
+#ifdef PROCESS_CONF_PRIORITIES
+#define PROCESS_PRIORITIES PROCESS_CONF_PRIORITIES
+#else /* PROCESS_CONF_PRIORITIES */
+#define PROCESS_PRIORITIES 1
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#ifndef PROCESS_CONF_BUDGETS
+#if PROCESS_PRIORITIES == 1
+#define PROCESS_CONF_BUDGETS { 1 }
+#elif PROCESS_PRIORITIES == 2
+#define PROCESS_CONF_BUDGETS { 4, 2 }
+#elif PROCESS_PRIORITIES == 3
+#define PROCESS_CONF_BUDGETS { 4, 4, 2 }
+#else
+#error "PROCESS_CONF_BUDGETS must be set for more than three priority classes"
+#endif
+#endif /* PROCESS_CONF_BUDGETS */
+/** @} */
+
+/**
+ * The number of events that the main loop of a platform delivers with
+ * process_run_batch() before it checks for I/O.
+ */
+#ifdef PROCESS_CONF_BATCH
+#define PROCESS_BATCH PROCESS_CONF_BATCH
+#else /* PROCESS_CONF_BATCH */
+#define PROCESS_BATCH 8
+#endif /* PROCESS_CONF_BATCH */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -364,6 +412,31 @@ CCIF void process_start(struct process *p, const char *arg);
  */
 CCIF int process_post(struct process *p, process_event_t ev, void* data);
 
+/**
+ * Post an asynchronous event with a specific priority.
+ *
+ * This function works like process_post(), but queues the event in
+ * the given priority class. process_post() queues PROCESS_EVENT_TIMER
+ * events as PROCESS_PRIO_TIMER and all other events as
+ * PROCESS_PRIO_APP.
+ *
+ * \param p The process to which the event should be posted, or
+ * PROCESS_BROADCAST if the event should be posted to all processes.
+ *
+ * \param ev The event to be posted.
+ *
+ * \param data The auxiliary data to be sent with the event
+ *
+ * \param prio The priority class, e.g. PROCESS_PRIO_NETWORK.
+ *
+ * \retval PROCESS_ERR_OK The event could be posted.
+ *
+ * \retval PROCESS_ERR_FULL The event queue of the priority class was
+ * full and the event could not be posted.
+ */
+CCIF int process_post_prio(struct process *p, process_event_t ev, void* data,
+                           unsigned char prio);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -499,6 +572,21 @@ void process_init(void);
  */
 int process_run(void);
 
+/**
+ * Run the system until a number of events have been processed.
+ *
+ * This function works like process_run(), but delivers up to \c max
+ * events, calling the poll handlers in between, and returns early if
+ * the event queues become empty. Events are taken from the priority
+ * classes according to their budgets.
+ *
+ * \param max The maximum number of events to process.
+ *
+ * \return The number of events that are currently waiting in the
+ * event queues.
+ */
+int process_run_batch(int max);
+
 
 /**
  * Check if a process is running.
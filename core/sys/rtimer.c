@@ -47,6 +47,20 @@
 #include "sys/rtimer.h"
 #include "contiki.h"
 
+#ifndef RTIMER_ARCH_LOCK
+#error "rtimer-arch.h must define RTIMER_ARCH_LOCK and RTIMER_ARCH_UNLOCK"
+#endif /* RTIMER_ARCH_LOCK */
+
+/* A timer that is set to a time that has already passed, such as a
+   16-bit compare register, only fires after the counter wraps. The
+   next task is therefore never scheduled closer than this to the
+   current time. */
+#ifdef RTIMER_ARCH_GUARD_TIME
+#define RTIMER_GUARD_TIME RTIMER_ARCH_GUARD_TIME
+#else /* RTIMER_ARCH_GUARD_TIME */
+#define RTIMER_GUARD_TIME 2
+#endif /* RTIMER_ARCH_GUARD_TIME */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -55,37 +69,103 @@
 #define PRINTF(...)
 #endif
 
-static struct rtimer *next_rtimer;
+/* The pending real-time tasks, sorted on their execution time with
+   the next task to be executed first. The hardware timer is always
+   programmed for the task at the head of the list. */
+static struct rtimer *rtimer_list;
 
 /*---------------------------------------------------------------------------*/
 void
 rtimer_init(void)
 {
+  rtimer_list = NULL;
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
+static void
+schedule_first(void)
+{
+  rtimer_clock_t earliest;
+
+  earliest = RTIMER_NOW() + RTIMER_GUARD_TIME;
+  if(RTIMER_CLOCK_LT(rtimer_list->time, earliest)) {
+    rtimer_arch_schedule(earliest);
+  } else {
+    rtimer_arch_schedule(rtimer_list->time);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+remove_rtimer(struct rtimer *rtimer)
+{
+  struct rtimer **tp;
+
+  for(tp = &rtimer_list; *tp != NULL; tp = &(*tp)->next) {
+    if(*tp == rtimer) {
+      *tp = rtimer->next;
+      rtimer->next = NULL;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
 	   rtimer_callback_t func, void *ptr)
 {
-  int first = 0;
+  struct rtimer **tp;
+  rtimer_arch_lock_t lock;
 
   PRINTF("rtimer_set time %d\n", time);
 
-  if(next_rtimer == NULL) {
-    first = 1;
-  }
+  RTIMER_ARCH_LOCK(lock);
+
+  /* A task that is set again is moved to its new position. */
+  remove_rtimer(rtimer);
 
   rtimer->func = func;
   rtimer->ptr = ptr;
 
   rtimer->time = time;
-  next_rtimer = rtimer;
 
-  if(first == 1) {
-    rtimer_arch_schedule(time);
+  /* Insert the task after all tasks that are to be executed at the
+     same time or before it. */
+  for(tp = &rtimer_list;
+      *tp != NULL && !RTIMER_CLOCK_LT(time, (*tp)->time);
+      tp = &(*tp)->next);
+  rtimer->next = *tp;
+  *tp = rtimer;
+
+  if(rtimer_list == rtimer) {
+    schedule_first();
   }
+
+  RTIMER_ARCH_UNLOCK(lock);
+  return RTIMER_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_cancel(struct rtimer *rtimer)
+{
+  int was_first;
+  rtimer_arch_lock_t lock;
+
+  RTIMER_ARCH_LOCK(lock);
+
+  was_first = (rtimer_list == rtimer);
+
+  if(!remove_rtimer(rtimer)) {
+    RTIMER_ARCH_UNLOCK(lock);
+    return RTIMER_ERR_NOT_SCHEDULED;
+  }
+
+  if(was_first && rtimer_list != NULL) {
+    schedule_first();
+  }
+
+  RTIMER_ARCH_UNLOCK(lock);
   return RTIMER_OK;
 }
 /*---------------------------------------------------------------------------*/
@@ -93,15 +173,35 @@ void
 rtimer_run_next(void)
 {
   struct rtimer *t;
-  if(next_rtimer == NULL) {
+  rtimer_clock_t now;
+  int due;
+
+  if(rtimer_list == NULL) {
     return;
   }
-  t = next_rtimer;
-  next_rtimer = NULL;
-  t->func(t, t->ptr);
-  if(next_rtimer != NULL) {
-    rtimer_arch_schedule(next_rtimer->time);
+
+  /* Run the task that the timer fired for and the tasks that were due
+     by then. A task that a callback sets for a time that has already
+     passed is run from the next interrupt, so that a task that keeps
+     setting itself cannot hold the CPU here. */
+  now = RTIMER_NOW();
+  due = 1;
+  for(t = rtimer_list->next;
+      t != NULL && !RTIMER_CLOCK_LT(now, t->time);
+      t = t->next) {
+    due++;
+  }
+
+  do {
+    t = rtimer_list;
+    rtimer_list = t->next;
+    t->next = NULL;
+    t->func(t, t->ptr);
+  } while(--due > 0 && rtimer_list != NULL &&
+          !RTIMER_CLOCK_LT(now, rtimer_list->time));
+
+  if(rtimer_list != NULL) {
+    schedule_first();
   }
-  return;
 }
 /*---------------------------------------------------------------------------*/
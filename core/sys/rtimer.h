@@ -61,6 +61,14 @@ typedef unsigned short rtimer_clock_t;
 
 #include "rtimer-arch.h"
 
+/*
+ * Tasks are set and cancelled from the main loop while the timer
+ * interrupt walks the task list. Each architecture defines
+ * rtimer_arch_lock_t, RTIMER_ARCH_LOCK(s) and RTIMER_ARCH_UNLOCK(s) in
+ * rtimer-arch.h to mask that interrupt around list updates, or as
+ * no-ops if it does not run the tasks from an interrupt.
+ */
+
 /**
  * \brief      Initialize the real-time scheduler.
  *
@@ -84,6 +92,7 @@ struct rtimer {
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
+  struct rtimer *next;
 };
 
 enum {
@@ -91,6 +100,7 @@ enum {
   RTIMER_ERR_FULL,
   RTIMER_ERR_TIME,
   RTIMER_ERR_ALREADY_SCHEDULED,
+  RTIMER_ERR_NOT_SCHEDULED,
 };
 
 /**
@@ -104,17 +114,36 @@ enum {
  *             (false) if the task could not be scheduled.
  *
  *             This function schedules a real-time task at a specified
- *             time in the future.
+ *             time in the future. Several tasks may be pending at the
+ *             same time; they are executed in the order of their
+ *             execution times. Setting a task that is already pending
+ *             reschedules it.
  *
  */
 int rtimer_set(struct rtimer *task, rtimer_clock_t time,
 	       rtimer_clock_t duration, rtimer_callback_t func, void *ptr);
 
 /**
- * \brief      Execute the next real-time task and schedule the next task, if any
+ * \brief      Cancel a pending real-time task.
+ * \param task A pointer to the task to cancel.
+ * \return     RTIMER_OK if the task was pending and has been
+ *             cancelled, RTIMER_ERR_NOT_SCHEDULED if the task was not
+ *             pending.
+ *
+ *             This function removes a real-time task that has
+ *             previously been scheduled with rtimer_set(). The task
+ *             function will not be called.
+ *
+ */
+int rtimer_cancel(struct rtimer *task);
+
+/**
+ * \brief      Execute the due real-time tasks and schedule the next task, if any
  *
  *             This function is called by the architecture dependent
- *             code to execute and schedule the next real-time task.
+ *             code to execute the next real-time task, and any other
+ *             tasks that are due by then, and to schedule the next
+ *             real-time task.
  *
  */
 void rtimer_run_next(void);
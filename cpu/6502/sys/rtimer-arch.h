@@ -39,4 +39,10 @@
 
 #define rtimer_arch_now() clock_time()
 
+/* Real-time tasks are not run from an interrupt, so the task list needs
+   no lock. */
+typedef int rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   ((s) = 0)
+#define RTIMER_ARCH_UNLOCK(s) ((void)(s))
+
 #endif /* RTIMER_ARCH_H_ */
@@ -9,6 +9,7 @@
 #define RTIMER_ARCH_H_
 
 #include "sys/rtimer.h"
+#include "interrupt-utils.h"
 
 #define RTIMER_ARCH_TIMER_ID AT91C_ID_TC1
 #define RTIMER_ARCH_TIMER_BASE AT91C_BASE_TC1
@@ -19,4 +20,9 @@ void rtimer_arch_set(rtimer_clock_t t);
 
 rtimer_clock_t rtimer_arch_now(void);
 
+/* Mask interrupts while the rtimer task list is changed. */
+typedef unsigned rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   ((s) = disableIRQ())
+#define RTIMER_ARCH_UNLOCK(s) restoreIRQ(s)
+
 #endif /* RTIMER_ARCH_H_ */
@@ -16,4 +16,10 @@ void rtimer_arch_set(rtimer_clock_t t);
 
 rtimer_clock_t rtimer_arch_now(void);
 
+/* Real-time tasks are not run from an interrupt, so the task list needs
+   no lock. */
+typedef int rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   ((s) = 0)
+#define RTIMER_ARCH_UNLOCK(s) ((void)(s))
+
 #endif /* RTIMER_ARCH_H_ */
@@ -68,4 +68,9 @@
 #endif
 
 void rtimer_arch_sleep(rtimer_clock_t howlong);
+/* Mask interrupts while the rtimer task list is changed. */
+typedef uint8_t rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   do { (s) = SREG; cli(); } while(0)
+#define RTIMER_ARCH_UNLOCK(s) (SREG = (s))
+
 #endif /* RTIMER_ARCH_H_ */
@@ -62,6 +62,7 @@
 
 #include "contiki.h"
 #include "dev/gptimer.h"
+#include "cpu.h"
 
 #define RTIMER_ARCH_SECOND 32768
 
@@ -74,6 +75,11 @@ rtimer_clock_t rtimer_arch_now(void);
  */
 rtimer_clock_t rtimer_arch_next_trigger(void);
 
+/* Mask interrupts while the rtimer task list is changed. */
+typedef unsigned long rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   ((s) = INTERRUPTS_DISABLE())
+#define RTIMER_ARCH_UNLOCK(s) do { if(!(s)) { INTERRUPTS_ENABLE(); } } while(0)
+
 #endif /* RTIMER_ARCH_H_ */
 
 /**
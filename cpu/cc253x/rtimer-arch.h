@@ -57,4 +57,9 @@
 
 void rtimer_isr(void) __interrupt(T1_VECTOR);
 
+/* Mask interrupts while the rtimer task list is changed. */
+typedef unsigned char rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   do { (s) = EA; EA = 0; } while(0)
+#define RTIMER_ARCH_UNLOCK(s) (EA = (s))
+
 #endif /* RTIMER_ARCH_H_ */
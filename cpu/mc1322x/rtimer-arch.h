@@ -58,4 +58,11 @@
 #define rtimer_arch_now() (CRM->RTC_COUNT)
 
 
+/* Mask the CRM interrupt, which runs the rtimer tasks, while the task
+   list is changed. */
+typedef uint32_t rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   do { (s) = *INTENABLE; disable_irq(CRM); } while(0)
+#define RTIMER_ARCH_UNLOCK(s) \
+  do { if((s) & (1 << INT_NUM_CRM)) { enable_irq(CRM); } } while(0)
+
 #endif /* RTIMER_ARCH_H_ */
@@ -50,4 +50,9 @@
 
 rtimer_clock_t rtimer_arch_now(void);
 
+/* Mask interrupts while the rtimer task list is changed. */
+typedef spl_t rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   ((s) = splhigh())
+#define RTIMER_ARCH_UNLOCK(s) splx(s)
+
 #endif /* RTIMER_ARCH_H_ */
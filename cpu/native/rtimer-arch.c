@@ -70,6 +70,18 @@ rtimer_arch_init(void)
 #endif /* !_WIN32 */
 }
 /*---------------------------------------------------------------------------*/
+#ifndef _WIN32
+void
+rtimer_arch_lock(sigset_t *saved)
+{
+  sigset_t block;
+
+  sigemptyset(&block);
+  sigaddset(&block, SIGALRM);
+  sigprocmask(SIG_BLOCK, &block, saved);
+}
+#endif /* !_WIN32 */
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
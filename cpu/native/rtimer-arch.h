@@ -46,4 +46,21 @@
 
 #define rtimer_arch_now() clock_time()
 
+#ifndef _WIN32
+#include <signal.h>
+
+/* Block the timer signal while the rtimer task list is changed. */
+typedef sigset_t rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   rtimer_arch_lock(&(s))
+#define RTIMER_ARCH_UNLOCK(s) sigprocmask(SIG_SETMASK, &(s), NULL)
+
+void rtimer_arch_lock(sigset_t *saved);
+#else /* !_WIN32 */
+/* Real-time tasks are not run from a signal, so the task list needs
+   no lock. */
+typedef int rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   ((s) = 0)
+#define RTIMER_ARCH_UNLOCK(s) ((void)(s))
+#endif /* !_WIN32 */
+
 #endif /* RTIMER_ARCH_H_ */
@@ -53,11 +53,19 @@
 #include "contiki-conf.h"
 
 #include <stdint.h>
+#include <pic32_irq.h>
 
 rtimer_clock_t rtimer_arch_now(void);
 
 #define RTIMER_ARCH_SECOND 312500
 
+/* Mask interrupts while the rtimer task list is changed. The di
+   instruction returns the previous status register, in which bit 0
+   is the interrupt enable bit. */
+typedef uint32_t rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   asm volatile("di %0" : "=r" (s))
+#define RTIMER_ARCH_UNLOCK(s) do { if((s) & 1) { ASM_EN_INT; } } while(0)
+
 #endif /* RTIMER_ARCH_H_ */
 
 /** @} */
@@ -93,5 +93,12 @@ void rtimer_arch_disable_irq(void);
 
 void rtimer_arch_enable_irq(void);
 
+/* Mask interrupts while the rtimer task list is changed. */
+uint8_t _disableBasePri(void);
+void _writeBasePri(uint8_t priority);
+typedef uint8_t rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   ((s) = _disableBasePri())
+#define RTIMER_ARCH_UNLOCK(s) _writeBasePri(s)
+
 #endif /* RTIMER_ARCH_H_ */
 /** @} */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the time of full relation scans in Antelope. The
+ *         benchmark fills a relation with synthetic sensor readings
+ *         and runs a few selections that cannot use an index. Build
+ *         with DEFINES=DB_SCAN_BATCH_SIZE=1 to compare with scans that
+ *         read and evaluate one tuple at a time.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+
+#include "antelope.h"
+
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+#define ROWS       3000
+#define ITERATIONS 50
+
+static const char *queries[] = {
+  "SELECT time, temp FROM readings WHERE temp > 900;",
+  "SELECT node, temp FROM readings WHERE node = 3 AND temp < 100;",
+  "SELECT COUNT(temp) FROM readings WHERE temp >= 500;",
+  "SELECT node, temp FROM readings WHERE temp - node > 990;"
+};
+
+static db_handle_t handle;
+/*---------------------------------------------------------------------------*/
+static db_result_t
+query(const char *q)
+{
+  db_result_t result;
+
+  result = db_query(&handle, q);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", q, db_get_result_message(result));
+  }
+  db_free(&handle);
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+static int
+create_relation(void)
+{
+  unsigned i;
+
+  db_query(&handle, "REMOVE RELATION readings;");
+  db_free(&handle);
+
+  if(DB_ERROR(query("CREATE RELATION readings;")) ||
+     DB_ERROR(query("CREATE ATTRIBUTE time DOMAIN LONG IN readings;")) ||
+     DB_ERROR(query("CREATE ATTRIBUTE node DOMAIN INT IN readings;")) ||
+     DB_ERROR(query("CREATE ATTRIBUTE temp DOMAIN INT IN readings;"))) {
+    return 0;
+  }
+
+  for(i = 0; i < ROWS; i++) {
+    if(DB_ERROR(db_query(&handle, "INSERT (%u, %u, %u) INTO readings;",
+                         i, random_rand() % 16, random_rand() % 1000))) {
+      printf("Failed to insert tuple %u\n", i);
+      db_free(&handle);
+      return 0;
+    }
+    db_free(&handle);
+  }
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *q)
+{
+  clock_time_t start, elapsed;
+  unsigned long matching, processed;
+  db_result_t result;
+  int i;
+
+  matching = processed = 0;
+  start = clock_time();
+  for(i = 0; i < ITERATIONS; i++) {
+    result = db_query(&handle, q);
+    if(DB_ERROR(result)) {
+      printf("Query \"%s\" failed: %s\n", q, db_get_result_message(result));
+      db_free(&handle);
+      return;
+    }
+    while(db_processing(&handle)) {
+      result = db_process(&handle);
+      if(result == DB_GOT_ROW) {
+        matching++;
+        processed++;
+      } else if(result == DB_OK) {
+        processed++;
+      } else {
+        if(DB_ERROR(result)) {
+          printf("Processing error: %s\n", db_get_result_message(result));
+        }
+        break;
+      }
+    }
+    db_free(&handle);
+  }
+  elapsed = clock_time() - start;
+
+  printf("%s\n  %lu of %lu tuples, %d scans in %lu ms\n", q,
+         matching / ITERATIONS, processed / ITERATIONS, ITERATIONS,
+         (unsigned long)elapsed * 1000 / CLOCK_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(scan_benchmark_process, "Antelope scan benchmark");
+AUTOSTART_PROCESSES(&scan_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(scan_benchmark_process, ev, data)
+{
+  static int i;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  printf("Creating a relation of %u tuples (batch size %u)\n",
+         ROWS, DB_SCAN_BATCH_SIZE);
+  if(!create_relation()) {
+    PROCESS_EXIT();
+  }
+
+  for(i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+    run(queries[i]);
+    PROCESS_PAUSE();
+  }
+
+  query("REMOVE RELATION readings;");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
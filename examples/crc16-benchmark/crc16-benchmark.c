@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Compares the throughput of crc16_data() with the bytewise
+ *         crc16_add() loop. crc16_data() is table-driven if the
+ *         platform sets CRC16_CONF_TABLE, and processes several bytes
+ *         per step if it sets CRC16_CONF_SLICES. Build with e.g.
+ *         DEFINES=CRC16_CONF_SLICES=1 to compare the variants.
+ */
+
+#include "contiki.h"
+#include "lib/crc16.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+#define BLOCK_SIZE 256
+#define DURATION   (CLOCK_SECOND * 4)
+
+static unsigned char block[BLOCK_SIZE];
+/*---------------------------------------------------------------------------*/
+static unsigned short
+crc16_bytewise(const unsigned char *data, int len, unsigned short acc)
+{
+  while(len-- > 0) {
+    acc = crc16_add(*data++, acc);
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name,
+    unsigned short (*crc)(const unsigned char *, int, unsigned short))
+{
+  clock_time_t start, elapsed;
+  unsigned long bytes;
+  unsigned short acc;
+
+  bytes = 0;
+  acc = 0;
+  start = clock_time();
+  do {
+    acc = crc(block, BLOCK_SIZE, acc);
+    bytes += BLOCK_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < DURATION);
+
+  printf("%s: %lu bytes in %lu ticks, %lu bytes/s (crc 0x%04x)\n",
+         name, bytes, (unsigned long)elapsed,
+         (unsigned long)(bytes / elapsed * CLOCK_SECOND), acc);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(crc16_benchmark_process, "CRC16 benchmark");
+AUTOSTART_PROCESSES(&crc16_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(crc16_benchmark_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < BLOCK_SIZE; i++) {
+    block[i] = random_rand();
+  }
+
+  /* Check the two implementations against each other, including the
+     tails shorter than a slice. */
+  for(i = 0; i <= BLOCK_SIZE; i++) {
+    if(crc16_data(block, i, i) != crc16_bytewise(block, i, i)) {
+      printf("crc16_data() differs from crc16_add() for %d bytes\n", i);
+      PROCESS_EXIT();
+    }
+  }
+
+  run("crc16_add", crc16_bytewise);
+  run("crc16_data", crc16_data);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
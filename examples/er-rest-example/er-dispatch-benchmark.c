@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      Measures how fast the REST Engine dispatches requests to one of
+ *      many resources. Build with e.g.
+ *      DEFINES=REST_RESOURCE_INDEX_SIZE=512 to dispatch through the
+ *      resource index instead of the resource list.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "contiki.h"
+#include "contiki-net.h"
+
+#if WITH_COAP == 12
+#include "er-coap-12.h"
+#elif WITH_COAP == 13
+#include "er-coap-13.h"
+#else
+#error "The dispatch benchmark requires WITH_COAP=12 or WITH_COAP=13"
+#endif
+
+#define RESOURCES   400
+#define URL_SIZE    20
+#define DURATION    (CLOCK_SECOND * 4)
+
+/* Even resources are "sensors/<n>/value", odd ones "actuators/<n>",
+   which also handle the sub-resource "actuators/<n>/state". */
+static resource_t resources[RESOURCES];
+static char urls[RESOURCES][URL_SIZE];
+static resource_t *dispatched;
+
+static coap_packet_t request[1];
+static coap_packet_t response[1];
+static uint8_t buffer[REST_MAX_CHUNK_SIZE];
+/*---------------------------------------------------------------------------*/
+static int
+record_pre_handler(resource_t *resource, void *request, void *response)
+{
+  dispatched = resource;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+benchmark_handler(void *request, void *response, uint8_t *buffer,
+                  uint16_t preferred_size, int32_t *offset)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_url(int i, char *url)
+{
+  if(i % 2) {
+    snprintf(url, URL_SIZE, "actuators/%03d/state", i);
+  } else {
+    strcpy(url, urls[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static resource_t *
+dispatch(const char *url)
+{
+  int32_t offset = 0;
+
+  dispatched = NULL;
+  coap_set_header_uri_path(request, url);
+  rest_invoke_restful_service(request, response, buffer, sizeof(buffer),
+                              &offset);
+  return dispatched;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(er_dispatch_benchmark, "REST dispatch benchmark");
+AUTOSTART_PROCESSES(&er_dispatch_benchmark);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(er_dispatch_benchmark, ev, data)
+{
+  static char url[URL_SIZE];
+  clock_time_t start, elapsed;
+  unsigned long requests;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < RESOURCES; i++) {
+    if(i % 2) {
+      snprintf(urls[i], URL_SIZE, "actuators/%03d", i);
+      resources[i].flags = METHOD_GET | HAS_SUB_RESOURCES;
+    } else {
+      snprintf(urls[i], URL_SIZE, "sensors/%03d/value", i);
+      resources[i].flags = METHOD_GET;
+    }
+    resources[i].url = urls[i];
+    resources[i].handler = benchmark_handler;
+    resources[i].pre_handler = record_pre_handler;
+    rest_activate_resource(&resources[i]);
+  }
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+
+  /* Check that every request reaches its resource before timing. */
+  for(i = 0; i < RESOURCES; i++) {
+    request_url(i, url);
+    if(dispatch(url) != &resources[i]) {
+      printf("/%s was not dispatched to /%s\n", url, urls[i]);
+      PROCESS_EXIT();
+    }
+  }
+  if(dispatch("sensors/000/valu") != NULL || dispatch("sensors") != NULL) {
+    printf("A request was dispatched to an unknown resource\n");
+    PROCESS_EXIT();
+  }
+
+  requests = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < RESOURCES; i++) {
+      request_url(i, url);
+      dispatch(url);
+    }
+    requests += RESOURCES;
+    elapsed = clock_time() - start;
+  } while(elapsed < DURATION);
+
+  printf("%d resources, index size %d: %lu requests in %lu ticks, %lu requests/s\n",
+         RESOURCES, REST_RESOURCE_INDEX_SIZE, requests,
+         (unsigned long)elapsed,
+         (unsigned long)(requests / elapsed * CLOCK_SECOND));
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -42,6 +42,10 @@
 #undef UIP_CONF_RECEIVE_WINDOW
 #define UIP_CONF_RECEIVE_WINDOW  60
 
+/* Keep network and timer events from queueing behind application
+   events */
+#define PROCESS_CONF_PRIORITIES 3
+
 #define SLIP_DEV_CONF_SEND_DELAY (CLOCK_SECOND / 32)
 
 #undef WEBSERVER_CONF_CFS_CONNS
@@ -282,11 +282,19 @@ serial_input(FILE *inslip)
 
 unsigned char slip_buf[2048];
 int slip_end, slip_begin, slip_packet_end, slip_packet_count;
-static struct timer send_delay_timer;
+/* A callback timer is used for the delay so that the main loop wakes
+   up to flush the next packet when the delay has passed. */
+static struct ctimer send_delay_timer;
 /* delay between slip packets */
 static clock_time_t send_delay = SEND_DELAY;
 /*---------------------------------------------------------------------------*/
 static void
+send_delay_expired(void *ptr)
+{
+  /* Nothing to do: the buffer is flushed from the select callback. */
+}
+/*---------------------------------------------------------------------------*/
+static void
 slip_send(int fd, unsigned char c)
 {
   if(slip_end >= sizeof(slip_buf)) {
@@ -345,7 +353,7 @@ slip_flushbuf(int fd)
         }
         /* a delay between slip packets to avoid losing data */
         if(send_delay > 0) {
-          timer_set(&send_delay_timer, send_delay);
+          ctimer_set(&send_delay_timer, send_delay, send_delay_expired, NULL);
         }
       }
     }
@@ -463,7 +471,7 @@ static int
 set_fd(fd_set *rset, fd_set *wset)
 {
   /* Anything to flush? */
-  if(!slip_empty() && (send_delay == 0 || timer_expired(&send_delay_timer))) {
+  if(!slip_empty() && (send_delay == 0 || ctimer_expired(&send_delay_timer))) {
     FD_SET(slipfd, wset);
   }
 
@@ -536,7 +544,7 @@ slip_init(void)
     stty_telos(slipfd);
   }
 
-  timer_set(&send_delay_timer, 0);
+  ctimer_stop(&send_delay_timer);
   slip_send(slipfd, SLIP_END);
   inslip = fdopen(slipfd, "r");
   if(inslip == NULL) {
@@ -43,4 +43,10 @@ int rtimer_arch_check(void);
 int rtimer_arch_pending(void);
 rtimer_clock_t rtimer_arch_next(void);
 
+/* Real-time tasks are run from the simulation loop, never while the
+   task list is changed, so it needs no lock. */
+typedef int rtimer_arch_lock_t;
+#define RTIMER_ARCH_LOCK(s)   ((s) = 0)
+#define RTIMER_ARCH_UNLOCK(s) ((void)(s))
+
 #endif /* RTIMER_ARCH_H_ */
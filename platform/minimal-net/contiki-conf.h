@@ -143,6 +143,9 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_MAX_LISTENPORTS      40
 #define UIP_CONF_MAX_CONNECTIONS      40
 #define UIP_CONF_BYTE_ORDER           UIP_LITTLE_ENDIAN
+#ifndef UIP_CONF_CHKSUM_WIDE
+#define UIP_CONF_CHKSUM_WIDE          1
+#endif /* UIP_CONF_CHKSUM_WIDE */
 #define UIP_CONF_TCP_SPLIT            0
 #define UIP_CONF_IP_FORWARD           0
 #define UIP_CONF_LOGGING              0
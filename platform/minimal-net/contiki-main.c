@@ -319,8 +319,14 @@ main(void)
     struct timeval tv;
     clock_time_t next_event;
     
-    n = process_run();
+    n = process_run_batch(PROCESS_BATCH);
     next_event = etimer_next_expiration_time() - clock_time();
+    if(!etimer_pending()) {
+      next_event = CLOCK_SECOND * 2;
+    } else if((long)next_event < 0) {
+      /* The next event timer has already expired. */
+      next_event = 0;
+    }
 
 #if DEBUG_SLEEP
     if(n > 0)
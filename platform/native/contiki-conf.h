@@ -57,6 +57,10 @@ int select_set_callback(int fd, const struct select_callback *callback);
 #define CCIF
 #define CLIF
 
+#ifndef MEMB_CONF_FREELIST
+#define MEMB_CONF_FREELIST 1
+#endif /* MEMB_CONF_FREELIST */
+
 /* These names are deprecated, use C99 names. */
 typedef uint8_t   u8_t;
 typedef uint16_t u16_t;
@@ -70,6 +74,9 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_MAX_LISTENPORTS 40
 #define UIP_CONF_BUFFER_SIZE     420
 #define UIP_CONF_BYTE_ORDER      UIP_LITTLE_ENDIAN
+#ifndef UIP_CONF_CHKSUM_WIDE
+#define UIP_CONF_CHKSUM_WIDE     1
+#endif /* UIP_CONF_CHKSUM_WIDE */
 #define UIP_CONF_TCP       1
 #define UIP_CONF_TCP_SPLIT       0
 #define UIP_CONF_LOGGING         0
@@ -272,6 +279,13 @@ typedef unsigned long clock_time_t;
 #define WWW_CONF_WEBPAGE_HEIGHT 17
 #endif /* PLATFORM_BUILD */
 
+#ifndef CRC16_CONF_TABLE
+#define CRC16_CONF_TABLE 1
+#endif /* CRC16_CONF_TABLE */
+#ifndef CRC16_CONF_SLICES
+#define CRC16_CONF_SLICES 8
+#endif /* CRC16_CONF_SLICES */
+
 /* Not part of C99 but actually present */
 int strcasecmp(const char*, const char*);
 
@@ -32,7 +32,9 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/select.h>
 
@@ -66,6 +68,48 @@
 #define SELECT_MAX 8
 #endif
 
+/* Use epoll(7) instead of select() to wait for file descriptors. The
+   registered interest of each file descriptor is only updated with
+   the kernel when it changes, and the main loop sleeps until the
+   next event timer expires or a file descriptor becomes ready. */
+#ifdef SELECT_CONF_EPOLL
+#define SELECT_EPOLL SELECT_CONF_EPOLL
+#elif defined(__linux__)
+#define SELECT_EPOLL 1
+#else
+#define SELECT_EPOLL 0
+#endif
+
+/* The longest time in milliseconds that the main loop sleeps when
+   waiting with epoll. */
+#ifdef SELECT_CONF_MAX_TIMEOUT
+#define SELECT_MAX_TIMEOUT SELECT_CONF_MAX_TIMEOUT
+#else
+#define SELECT_MAX_TIMEOUT 1000
+#endif
+
+#if SELECT_EPOLL
+#include <sys/epoll.h>
+
+#define EPOLL_REGISTERED   0x01
+#define EPOLL_READ         0x02
+#define EPOLL_WRITE        0x04
+/* The file descriptor can not be used with epoll, e.g. a regular
+   file, and is always considered ready like select() would. */
+#define EPOLL_ALWAYS_READY 0x08
+
+#define EPOLL_MAX_EVENTS   16
+
+/* The select callbacks may watch any file descriptor, so the state is
+   kept for every descriptor that fits in an fd_set. */
+static int epoll_fd = -1;
+static uint8_t epoll_state[FD_SETSIZE];
+/* The interest of the callbacks when the epoll set was last updated. */
+static fd_set epoll_fdr, epoll_fdw;
+static int epoll_max_fd = -1;
+static int epoll_always_ready;
+#endif /* SELECT_EPOLL */
+
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
@@ -106,6 +150,155 @@ select_set_callback(int fd, const struct select_callback *callback)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+static int
+next_timeout(void)
+{
+  clock_time_t now, next;
+  long diff;
+
+  if(!etimer_pending()) {
+    return SELECT_MAX_TIMEOUT;
+  }
+
+  now = clock_time();
+  next = etimer_next_expiration_time();
+  diff = (long)(next - now);
+  if(diff <= 0) {
+    return 0;
+  }
+  diff = diff * 1000 / CLOCK_SECOND;
+  return diff < SELECT_MAX_TIMEOUT ? (int)diff : SELECT_MAX_TIMEOUT;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_update(int fd, uint8_t state)
+{
+  struct epoll_event event;
+  int op;
+
+  if((epoll_state[fd] & EPOLL_ALWAYS_READY) && state != 0) {
+    return;
+  }
+  state = state ? state | EPOLL_REGISTERED : 0;
+  if(state == epoll_state[fd]) {
+    return;
+  }
+
+  memset(&event, 0, sizeof(event));
+  event.data.fd = fd;
+  if(state & EPOLL_READ) {
+    event.events |= EPOLLIN;
+  }
+  if(state & EPOLL_WRITE) {
+    event.events |= EPOLLOUT;
+  }
+
+  if(state == 0) {
+    op = EPOLL_CTL_DEL;
+  } else if(epoll_state[fd] & EPOLL_REGISTERED) {
+    op = EPOLL_CTL_MOD;
+  } else {
+    op = EPOLL_CTL_ADD;
+  }
+
+  if(epoll_ctl(epoll_fd, op, fd, &event) < 0) {
+    if(errno == EPERM) {
+      state = EPOLL_ALWAYS_READY;
+    } else if(op != EPOLL_CTL_DEL) {
+      perror("epoll_ctl");
+      return;
+    }
+  }
+  if(state & EPOLL_ALWAYS_READY) {
+    epoll_always_ready++;
+  } else if(epoll_state[fd] & EPOLL_ALWAYS_READY) {
+    epoll_always_ready--;
+  }
+  if(state != 0 && fd > epoll_max_fd) {
+    epoll_max_fd = fd;
+  }
+  epoll_state[fd] = state;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_wait_fds(int pending)
+{
+  struct epoll_event events[EPOLL_MAX_EVENTS];
+  fd_set fdr, fdw, rready, wready;
+  int i, n, max_fd, timeout;
+
+  if(epoll_fd < 0) {
+    epoll_fd = epoll_create1(0);
+    if(epoll_fd < 0) {
+      perror("epoll_create1");
+      exit(1);
+    }
+  }
+
+  /* Let the callbacks tell which file descriptors they are interested
+     in, and update the epoll set if this has changed. */
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL) {
+      select_callback[i]->set_fd(&fdr, &fdw);
+    }
+  }
+
+  if(memcmp(&fdr, &epoll_fdr, sizeof(fdr)) != 0 ||
+     memcmp(&fdw, &epoll_fdw, sizeof(fdw)) != 0) {
+    for(i = 0; i < FD_SETSIZE; i++) {
+      epoll_update(i, (FD_ISSET(i, &fdr) ? EPOLL_READ : 0) |
+                   (FD_ISSET(i, &fdw) ? EPOLL_WRITE : 0));
+    }
+    epoll_fdr = fdr;
+    epoll_fdw = fdw;
+  }
+
+  FD_ZERO(&rready);
+  FD_ZERO(&wready);
+  timeout = pending ? 0 : next_timeout();
+  if(epoll_always_ready > 0) {
+    max_fd = epoll_max_fd;
+    for(i = 0; i <= max_fd; i++) {
+      if(epoll_state[i] & EPOLL_ALWAYS_READY) {
+        if(FD_ISSET(i, &fdr)) {
+          FD_SET(i, &rready);
+        }
+        if(FD_ISSET(i, &fdw)) {
+          FD_SET(i, &wready);
+        }
+        timeout = 0;
+      }
+    }
+  }
+
+  n = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, timeout);
+  if(n < 0) {
+    if(errno != EINTR) {
+      perror("epoll_wait");
+    }
+    return;
+  }
+
+  for(i = 0; i < n; i++) {
+    if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+      FD_SET(events[i].data.fd, &rready);
+    }
+    if(events[i].events & (EPOLLOUT | EPOLLERR)) {
+      FD_SET(events[i].data.fd, &wready);
+    }
+  }
+
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL) {
+      select_callback[i]->handle_fd(&rready, &wready);
+    }
+  }
+}
+#endif /* SELECT_EPOLL */
+/*---------------------------------------------------------------------------*/
 static int
 stdin_set_fd(fd_set *rset, fd_set *wset)
 {
@@ -236,6 +429,9 @@ main(int argc, char **argv)
 
   select_set_callback(STDIN_FILENO, &stdin_fd);
   while(1) {
+#if SELECT_EPOLL
+    epoll_wait_fds(process_run_batch(PROCESS_BATCH));
+#else /* SELECT_EPOLL */
     fd_set fdr;
     fd_set fdw;
     int maxfd;
@@ -243,7 +439,7 @@ main(int argc, char **argv)
     int retval;
     struct timeval tv;
 
-    retval = process_run();
+    retval = process_run_batch(PROCESS_BATCH);
 
     tv.tv_sec = 0;
     tv.tv_usec = retval ? 1 : 1000;
@@ -268,6 +464,7 @@ main(int argc, char **argv)
         }
       }
     }
+#endif /* SELECT_EPOLL */
 
     etimer_request_poll();
 
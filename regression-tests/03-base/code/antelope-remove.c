@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Removes tuples from an Antelope relation with a condition on
+ *         an indexed attribute, and checks that exactly the matching
+ *         tuples are gone.
+ */
+
+#include "contiki.h"
+
+#include "antelope.h"
+#include "db-options.h"
+
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+#define ROWS    20
+#define VALUES  5
+#define REMOVED 2
+
+static const char *index_types[] = {
+#if DB_FEATURE_COFFEE
+  /* The max-heap index reads the file space that Coffee reserves. */
+  "MAXHEAP",
+#endif /* DB_FEATURE_COFFEE */
+  "BTREE"
+};
+
+static db_handle_t handle;
+/*---------------------------------------------------------------------------*/
+static db_result_t
+query(const char *q)
+{
+  db_result_t result;
+
+  result = db_query(&handle, q);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", q, db_get_result_message(result));
+  }
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+static db_result_t
+process(void)
+{
+  db_result_t result;
+
+  result = DB_OK;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result != DB_OK && result != DB_GOT_ROW) {
+      break;
+    }
+  }
+  return DB_ERROR(result) ? result : DB_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+create_relation(const char *index_type)
+{
+  db_result_t result;
+  unsigned i;
+
+  db_query(&handle, "REMOVE RELATION r;");
+  db_free(&handle);
+
+  if(DB_ERROR(query("CREATE RELATION r;")) ||
+     DB_ERROR(query("CREATE ATTRIBUTE a DOMAIN INT IN r;")) ||
+     DB_ERROR(query("CREATE ATTRIBUTE b DOMAIN INT IN r;"))) {
+    return 0;
+  }
+  db_free(&handle);
+
+  result = db_query(&handle, "CREATE INDEX r.a TYPE %s;", index_type);
+  if(!DB_ERROR(result)) {
+    result = process();
+  }
+  if(DB_ERROR(result)) {
+    printf("Failed to create a %s index: %s\n", index_type,
+           db_get_result_message(result));
+    db_free(&handle);
+    return 0;
+  }
+  db_free(&handle);
+
+  for(i = 0; i < ROWS; i++) {
+    if(DB_ERROR(db_query(&handle, "INSERT (%u, %u) INTO r;",
+                         i % VALUES, i))) {
+      printf("Failed to insert tuple %u\n", i);
+      db_free(&handle);
+      return 0;
+    }
+    db_free(&handle);
+  }
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_remaining(void)
+{
+  attribute_value_t a, b;
+  unsigned count;
+  int ok;
+
+  if(DB_ERROR(query("SELECT a, b FROM r;"))) {
+    db_free(&handle);
+    return 0;
+  }
+
+  count = 0;
+  ok = 1;
+  while(db_processing(&handle)) {
+    switch(db_process(&handle)) {
+    case DB_GOT_ROW:
+      if(DB_ERROR(db_get_value(&a, &handle, 0)) ||
+         DB_ERROR(db_get_value(&b, &handle, 1)) ||
+         db_value_to_long(&a) == REMOVED ||
+         db_value_to_long(&a) != db_value_to_long(&b) % VALUES) {
+        ok = 0;
+      }
+      count++;
+      break;
+    case DB_OK:
+      break;
+    default:
+      goto done;
+    }
+  }
+done:
+  db_free(&handle);
+
+  printf("%u tuples remain\n", count);
+  return ok && count == ROWS - ROWS / VALUES;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_remove_process, "Antelope REMOVE test");
+AUTOSTART_PROCESSES(&antelope_remove_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_remove_process, ev, data)
+{
+  static int i;
+  static int failed;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  failed = 0;
+  for(i = 0; i < sizeof(index_types) / sizeof(index_types[0]); i++) {
+    printf("Removing tuples with a %s index\n", index_types[i]);
+    if(!create_relation(index_types[i]) ||
+       DB_ERROR(db_query(&handle, "REMOVE FROM r WHERE a = %u;", REMOVED)) ||
+       DB_ERROR(process())) {
+      db_free(&handle);
+      failed = 1;
+      break;
+    }
+    db_free(&handle);
+    if(!check_remaining()) {
+      failed = 1;
+      break;
+    }
+    PROCESS_PAUSE();
+  }
+
+  query("REMOVE RELATION r;");
+  db_free(&handle);
+
+  printf("%s\n", failed ? "TEST FAILED" : "TEST OK");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/